@@ -1,195 +1,711 @@
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <vector>
-#include <iomanip>
 #include <stdlib.h>
 
 using std::vector;
 
 class BigInteger {
-  vector<int64_t> digits_;
-  static const int64_t n_digits_ = 8;
-  static const int64_t base_ = 100000000;
+ public:
+  // Multiplication method, for benchmarks and tests. kAuto picks by operand
+  // size; a forced method applies to the top-level product only, and a
+  // forced kKaratsuba or kToom3 still slices very unbalanced operands.
+  enum class Multiplication { kAuto, kSchoolbook, kKaratsuba, kToom3, kNtt };
+
+ private:
+  // Magnitude in little-endian base-2^64 limbs, at least one limb for a value
+  // made by any constructor except the default one. Decimal only appears in
+  // toString and in parsing.
+  vector<uint64_t> limbs_;
   bool is_negative_ = false;
 
+  // Largest power of ten in a limb, the chunk size of decimal conversion.
+  static const uint64_t kDecimalBase = 10000000000000000000ull;
+  static const int kDecimalDigits = 19;
+
   void CheckForZero() {
-    if (digits_.empty() or (digits_.size() == 1 && digits_.front() == 0)) {
+    if (limbs_.empty() or (limbs_.size() == 1 && limbs_.front() == 0)) {
       is_negative_ = false;
     }
   }
 
   void removeLeadingZeros() {
-    while (digits_.size() > 1 && digits_.back() == 0) {
-      digits_.pop_back();
+    while (limbs_.size() > 1 && limbs_.back() == 0) {
+      limbs_.pop_back();
     }
     CheckForZero();
   }
 
   BigInteger Add(const BigInteger& first, const BigInteger& second) {
-    const vector<int64_t>& num1 = first.digits_;
-    const vector<int64_t>& num2 = second.digits_;
-    size_t max_size = std::max(num1.size(), num2.size()) + 1;
     BigInteger result(first);
- 
-    if (max_size > result.digits_.size()) {
-      result.digits_.resize(max_size + 1);
+    result.limbs_.resize(std::max(first.limbs_.size(), second.limbs_.size()) + 1);
+    AddLimbs(result.limbs_, second.limbs_.data(), second.limbs_.size(), 0);
+    result.removeLeadingZeros();
+    return result;
+  }
+
+  // |first| >= |second|.
+  BigInteger Difference(const BigInteger& first, const BigInteger& second) {
+    BigInteger result(first);
+    SubtractLimbs(result.limbs_, second.limbs_);
+    result.removeLeadingZeros();
+    return result;
+  }
+
+  // Multiplication engine over magnitudes: little-endian limbs, leading zeros
+  // allowed. Each product is written as exactly n + m limbs. Operands below
+  // kKaratsubaThreshold limbs go through schoolbook, then Karatsuba up to
+  // kToom3Threshold, then Toom-3, and from kNttThreshold on a number-theoretic
+  // transform. The thresholds are measured crossovers.
+  static const size_t kKaratsubaThreshold = 48;
+  static const size_t kToom3Threshold = 300;
+  static const size_t kNttThreshold = 6000;
+
+  // acc += x * 2^(64 shift); acc must be long enough for the sum.
+  static void AddLimbs(vector<uint64_t>& acc, const uint64_t* x, size_t n, size_t shift) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n || carry; ++i) {
+      uint64_t add = i < n ? x[i] : 0;
+      uint64_t sum = acc[shift + i] + add;
+      uint64_t next_carry = sum < add;
+      acc[shift + i] = sum + carry;
+      carry = next_carry | (acc[shift + i] < carry);
+    }
+  }
+
+  // acc -= x; acc must not be smaller than x.
+  static void SubtractLimbs(vector<uint64_t>& acc, const vector<uint64_t>& x) {
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < x.size() || borrow; ++i) {
+      uint64_t sub = i < x.size() ? x[i] : 0;
+      uint64_t diff = acc[i] - sub;
+      uint64_t next_borrow = acc[i] < sub;
+      next_borrow |= diff < borrow;
+      acc[i] = diff - borrow;
+      borrow = next_borrow;
     }
+  }
+
+  static vector<uint64_t> SumLimbs(const uint64_t* a, size_t n, const uint64_t* b, size_t m) {
+    vector<uint64_t> sum(std::max(n, m) + 1, 0);
+    std::copy(a, a + n, sum.begin());
+    AddLimbs(sum, b, m, 0);
+    return sum;
+  }
 
-    int64_t temp = 0;
-    for (size_t i = 0; i < max_size || temp; ++i) {
-      result.digits_[i] += temp;
-      if (i < num2.size()) {
-        result.digits_[i] += num2[i];
+  // One row per limb of a: a 64x64->128 multiply-accumulate with the carry in
+  // the high half.
+  static void MultiplySchoolbook(const uint64_t* a, size_t n, const uint64_t* b, size_t m,
+                                 uint64_t* out) {
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t x = a[i];
+      if (x == 0) continue;
+      uint64_t* row = out + i;
+      uint64_t carry = 0;
+      for (size_t j = 0; j < m; ++j) {
+        unsigned __int128 t = static_cast<unsigned __int128>(x) * b[j] + row[j] + carry;
+        row[j] = static_cast<uint64_t>(t);
+        carry = static_cast<uint64_t>(t >> 64);
       }
-      temp = result.digits_[i] / result.base_;
-      result.digits_[i] %= result.base_;
+      row[m] = carry;
     }
+  }
+
+  // n >= m > n / 2. Splits at half of a and uses
+  // (a0 + a1)(b0 + b1) - a0 b0 - a1 b1 for the middle term.
+  static vector<uint64_t> MultiplyKaratsuba(const uint64_t* a, size_t n, const uint64_t* b,
+                                            size_t m) {
+    size_t k = n / 2;
+    size_t m0 = std::min(k, m);
+    vector<uint64_t> result(n + m, 0);
+    vector<uint64_t> z0 = MultiplyLimbs(a, k, b, m0);
+    vector<uint64_t> z2 = MultiplyLimbs(a + k, n - k, b + m0, m - m0);
+    vector<uint64_t> sum_a = SumLimbs(a, k, a + k, n - k);
+    vector<uint64_t> sum_b = SumLimbs(b, m0, b + m0, m - m0);
+    vector<uint64_t> z1 = MultiplyLimbs(sum_a.data(), sum_a.size(), sum_b.data(), sum_b.size());
+    SubtractLimbs(z1, z0);
+    SubtractLimbs(z1, z2);
+    while (!z1.empty() && z1.back() == 0) z1.pop_back();
+    AddLimbs(result, z0.data(), z0.size(), 0);
+    AddLimbs(result, z2.data(), z2.size(), 2 * k);
+    AddLimbs(result, z1.data(), z1.size(), k);
+    return result;
+  }
+
+  static BigInteger FromLimbs(const uint64_t* a, size_t n) {
+    BigInteger result;
+    result.limbs_.assign(a, a + n);
+    if (result.limbs_.empty()) result.limbs_.push_back(0);
     result.removeLeadingZeros();
     return result;
   }
 
-  BigInteger Difference(const BigInteger& first, const BigInteger& second) {
-    const vector<int64_t>& num1 = first.digits_;
-    const vector<int64_t>& num2 = second.digits_;
-    BigInteger result(first);
+  // Divides the magnitude by a non-zero limb in place and returns the
+  // remainder.
+  uint64_t DivideByLimb(uint64_t divisor) {
+    unsigned __int128 rest = 0;
+    for (size_t i = limbs_.size(); i-- > 0;) {
+      unsigned __int128 current = (rest << 64) | limbs_[i];
+      limbs_[i] = static_cast<uint64_t>(current / divisor);
+      rest = current % divisor;
+    }
+    removeLeadingZeros();
+    return static_cast<uint64_t>(rest);
+  }
 
-    int64_t temp = 0;
-    for (size_t i = 0; i < std::min(num1.size(), num2.size()) || temp; ++i) {
-      if (i >= num2.size()) {
-        result.digits_[i] -= temp;
-      } else {
-        result.digits_[i] -= (temp + num2[i]);
+  // Magnitude = magnitude * factor + addend.
+  void MultiplyAddLimb(uint64_t factor, uint64_t addend) {
+    uint64_t carry = addend;
+    for (uint64_t& limb : limbs_) {
+      unsigned __int128 t = static_cast<unsigned __int128>(limb) * factor + carry;
+      limb = static_cast<uint64_t>(t);
+      carry = static_cast<uint64_t>(t >> 64);
+    }
+    if (carry != 0) limbs_.push_back(carry);
+  }
+
+  // Exact division of a multiple of divisor by a small positive divisor.
+  static BigInteger DivideExact(BigInteger value, uint64_t divisor) {
+    value.DivideByLimb(divisor);
+    return value;
+  }
+
+  // n >= m > n / 2. Splits both operands into three parts of k limbs,
+  // evaluates at 0, 1, -1, -2 and infinity and interpolates with Bodrato's
+  // sequence. The evaluations can be negative, so they are BigIntegers.
+  static vector<uint64_t> MultiplyToom3(const uint64_t* a, size_t n, const uint64_t* b, size_t m) {
+    size_t k = (n + 2) / 3;
+    auto part = [k](const uint64_t* x, size_t len, size_t i) {
+      size_t from = std::min(len, i * k);
+      return FromLimbs(x + from, std::min(len, from + k) - from);
+    };
+    BigInteger a0 = part(a, n, 0), a1 = part(a, n, 1), a2 = part(a, n, 2);
+    BigInteger b0 = part(b, m, 0), b1 = part(b, m, 1), b2 = part(b, m, 2);
+
+    // The free operators are declared after the class
+    auto plus = [](BigInteger x, const BigInteger& y) { return x += y; };
+    auto minus = [](BigInteger x, const BigInteger& y) { return x -= y; };
+
+    BigInteger pa = plus(a0, a2);
+    BigInteger pb = plus(b0, b2);
+    BigInteger pa_1 = plus(pa, a1), pa_m1 = minus(pa, a1);
+    BigInteger pb_1 = plus(pb, b1), pb_m1 = minus(pb, b1);
+    BigInteger pa_m2 = plus(pa_m1, a2);
+    pa_m2 = minus(plus(pa_m2, pa_m2), a0);
+    BigInteger pb_m2 = plus(pb_m1, b2);
+    pb_m2 = minus(plus(pb_m2, pb_m2), b0);
+
+    BigInteger r0 = Multiply(a0, b0);
+    BigInteger r1 = Multiply(pa_1, pb_1);
+    BigInteger r_m1 = Multiply(pa_m1, pb_m1);
+    BigInteger r_m2 = Multiply(pa_m2, pb_m2);
+    BigInteger r_inf = Multiply(a2, b2);
+
+    BigInteger r3 = DivideExact(minus(r_m2, r1), 3);
+    r1 = DivideExact(minus(r1, r_m1), 2);
+    BigInteger r2 = minus(r_m1, r0);
+    r3 = plus(plus(DivideExact(minus(r2, r3), 2), r_inf), r_inf);
+    r2 = minus(plus(r2, r1), r_inf);
+    r1 -= r3;
+
+    // The coefficients of the product polynomial are never negative. For
+    // operands of a few limbs the higher ones are zero but still start past
+    // n + m, so the sum is sized to hold every coefficient.
+    const BigInteger* coefficients[] = {&r0, &r1, &r2, &r3, &r_inf};
+    size_t size = n + m + 1;
+    for (size_t i = 0; i < 5; ++i) {
+      size = std::max(size, i * k + coefficients[i]->limbs_.size() + 1);
+    }
+    vector<uint64_t> result(size, 0);
+    for (size_t i = 0; i < 5; ++i) {
+      const vector<uint64_t>& limbs = coefficients[i]->limbs_;
+      AddLimbs(result, limbs.data(), limbs.size(), i * k);
+    }
+    result.resize(n + m);
+    return result;
+  }
+
+  // Number-theoretic transform modulo a prime of the form c * 2^k + 1 with
+  // primitive root 3, for power-of-two sizes up to 2^k. Mod is a template
+  // parameter so that every % compiles to a multiplication.
+  template <uint32_t Mod>
+  static uint32_t PowMod(uint64_t base, uint64_t exp) {
+    uint64_t result = 1;
+    for (base %= Mod; exp > 0; exp >>= 1) {
+      if (exp & 1) result = result * base % Mod;
+      base = base * base % Mod;
+    }
+    return static_cast<uint32_t>(result);
+  }
+
+  template <uint32_t Mod>
+  static void Ntt(vector<uint32_t>& a, bool invert) {
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+      size_t bit = n >> 1;
+      for (; j & bit; bit >>= 1) j ^= bit;
+      j ^= bit;
+      if (i < j) std::swap(a[i], a[j]);
+    }
+    vector<uint32_t> roots(n / 2);
+    for (size_t len = 2; len <= n; len <<= 1) {
+      size_t half = len / 2;
+      uint64_t root = PowMod<Mod>(3, (Mod - 1) / len);
+      if (invert) root = PowMod<Mod>(root, Mod - 2);
+      roots[0] = 1;
+      for (size_t j = 1; j < half; ++j) roots[j] = roots[j - 1] * root % Mod;
+      for (size_t i = 0; i < n; i += len) {
+        uint32_t* low = a.data() + i;
+        uint32_t* high = low + half;
+        for (size_t j = 0; j < half; ++j) {
+          uint32_t u = low[j];
+          uint32_t v = static_cast<uint64_t>(high[j]) * roots[j] % Mod;
+          low[j] = u + v >= Mod ? u + v - Mod : u + v;
+          high[j] = u >= v ? u - v : u + Mod - v;
+        }
+      }
+    }
+    if (invert) {
+      uint64_t inv_n = PowMod<Mod>(n, Mod - 2);
+      for (uint32_t& x : a) x = x * inv_n % Mod;
+    }
+  }
+
+  // Cyclic convolution modulo Mod of the 32-bit halves of a and b, of the
+  // given power-of-two size.
+  template <uint32_t Mod>
+  static vector<uint32_t> Convolve(const uint64_t* a, size_t n, const uint64_t* b, size_t m,
+                                   size_t size) {
+    auto halves = [size](const uint64_t* x, size_t len) {
+      vector<uint32_t> result(size, 0);
+      for (size_t i = 0; i < len; ++i) {
+        result[2 * i] = static_cast<uint32_t>(x[i]) % Mod;
+        result[2 * i + 1] = static_cast<uint32_t>(x[i] >> 32) % Mod;
       }
-      if (result.digits_[i] < 0) {
-        result.digits_[i] += result.base_;
-        temp = 1;
+      return result;
+    };
+    vector<uint32_t> fa = halves(a, n);
+    vector<uint32_t> fb = halves(b, m);
+    Ntt<Mod>(fa, false);
+    Ntt<Mod>(fb, false);
+    for (size_t i = 0; i < size; ++i) {
+      fa[i] = static_cast<uint64_t>(fa[i]) * fb[i] % Mod;
+    }
+    Ntt<Mod>(fa, true);
+    return fa;
+  }
+
+  static const uint32_t kNttPrime1 = 998244353;  // 119 * 2^23 + 1
+  static const uint32_t kNttPrime2 = 167772161;  // 5 * 2^25 + 1
+  static const uint32_t kNttPrime3 = 469762049;  // 7 * 2^26 + 1
+  // Transform length limit of kNttPrime1, in 32-bit halves.
+  static const size_t kNttMaxSize = size_t(1) << 23;
+
+  // Convolves the 32-bit halves modulo three primes and recombines with
+  // Garner's formula. With at most 2^23 points, a coefficient is below
+  // 2^22 * (2^32 - 1)^2 < 2^86, under the product of the primes (about
+  // 2^86.02), so the recombination is exact.
+  static vector<uint64_t> MultiplyNtt(const uint64_t* a, size_t n, const uint64_t* b, size_t m) {
+    size_t size = 1;
+    while (size < 2 * (n + m) - 1) size <<= 1;
+    vector<uint32_t> r1 = Convolve<kNttPrime1>(a, n, b, m, size);
+    vector<uint32_t> r2 = Convolve<kNttPrime2>(a, n, b, m, size);
+    vector<uint32_t> r3 = Convolve<kNttPrime3>(a, n, b, m, size);
+
+    const uint64_t p1 = kNttPrime1;
+    const uint64_t p2 = kNttPrime2;
+    const uint64_t p3 = kNttPrime3;
+    const uint64_t p1_inv_mod_p2 = PowMod<kNttPrime2>(p1, p2 - 2);
+    const uint64_t p1_inv_mod_p3 = PowMod<kNttPrime3>(p1, p3 - 2);
+    const uint64_t p2_inv_mod_p3 = PowMod<kNttPrime3>(p2, p3 - 2);
+
+    vector<uint64_t> result(n + m, 0);
+    unsigned __int128 carry = 0;
+    for (size_t i = 0; i < 2 * (n + m); ++i) {
+      uint64_t x1 = r1[i];
+      uint64_t x2 = (r2[i] + p2 - x1 % p2) % p2 * p1_inv_mod_p2 % p2;
+      uint64_t x3 = ((r3[i] + p3 - x1 % p3) % p3 * p1_inv_mod_p3 % p3 + p3 - x2) % p3 *
+                    p2_inv_mod_p3 % p3;
+      carry += x1 + x2 * p1 + static_cast<unsigned __int128>(x3) * (p1 * p2);
+      result[i / 2] |= static_cast<uint64_t>(static_cast<uint32_t>(carry)) << (32 * (i % 2));
+      carry >>= 32;
+    }
+    return result;
+  }
+
+  static vector<uint64_t> MultiplyLimbs(const uint64_t* a, size_t n, const uint64_t* b, size_t m,
+                                        Multiplication method = Multiplication::kAuto) {
+    if (n < m) {
+      std::swap(a, b);
+      std::swap(n, m);
+    }
+    size_t size = n + m;
+    while (m > 0 && b[m - 1] == 0) --m;
+    vector<uint64_t> result(size, 0);
+    if (m == 0) return result;
+    if (method == Multiplication::kAuto) {
+      if (m < kKaratsubaThreshold) {
+        method = Multiplication::kSchoolbook;
+      } else if (m >= kNttThreshold && 2 * (n + m) <= kNttMaxSize) {
+        method = Multiplication::kNtt;
+      } else if (m < kToom3Threshold) {
+        method = Multiplication::kKaratsuba;
       } else {
-        temp = 0;
+        method = Multiplication::kToom3;
       }
     }
-    result.removeLeadingZeros();
+    if (method == Multiplication::kSchoolbook) {
+      MultiplySchoolbook(a, n, b, m, result.data());
+    } else if (method == Multiplication::kNtt && 2 * (n + m) <= kNttMaxSize) {
+      result = MultiplyNtt(a, n, b, m);
+    } else if (n > 2 * m) {
+      // Unbalanced: multiply b by m-limb slices of a
+      for (size_t i = 0; i < n; i += m) {
+        size_t len = std::min(m, n - i);
+        vector<uint64_t> slice = MultiplyLimbs(a + i, len, b, m);
+        while (!slice.empty() && slice.back() == 0) slice.pop_back();
+        AddLimbs(result, slice.data(), slice.size(), i);
+      }
+    } else if (method == Multiplication::kKaratsuba) {
+      result = MultiplyKaratsuba(a, n, b, m);
+    } else {
+      result = MultiplyToom3(a, n, b, m);
+    }
+    result.resize(size);
     return result;
   }
 
-  BigInteger Multiply(const BigInteger& first, const BigInteger& second) {
+  static BigInteger Multiply(const BigInteger& first, const BigInteger& second,
+                             Multiplication method = Multiplication::kAuto) {
     if (second == 0 || first == 0) {
       return 0;
     }
-    BigInteger ans(first);
-    const vector<int64_t>& num1 = ans.digits_;
-    const vector<int64_t>& num2 = second.digits_;
-    vector<int64_t> result(num1.size() + num2.size() + 1, 0);
+    BigInteger ans;
+    ans.limbs_ = MultiplyLimbs(first.limbs_.data(), first.limbs_.size(),
+                               second.limbs_.data(), second.limbs_.size(), method);
+    ans.is_negative_ = first.is_negative_ != second.is_negative_;
+    ans.removeLeadingZeros();
+    return ans;
+  }
 
-    if (first.is_negative_ == second.is_negative_) {
-      ans.is_negative_ = false;
-    } else {
-      ans.is_negative_ = true;
+  static BigInteger FromLimb(uint64_t limb) {
+    BigInteger result;
+    result.limbs_.push_back(limb);
+    return result;
+  }
+
+  // x * 2^shift as out_len limbs, shift < 64.
+  static vector<uint64_t> ShiftLeft(const uint64_t* x, size_t len, size_t out_len, int shift) {
+    vector<uint64_t> result(out_len, 0);
+    for (size_t i = 0; i < len; ++i) {
+      result[i] |= x[i] << shift;
+      if (shift != 0 && i + 1 < out_len) result[i + 1] = x[i] >> (64 - shift);
     }
+    return result;
+  }
 
-    for (size_t i = 0; i < num1.size(); ++i) {
-      int64_t temp = 0;
-      for (size_t j = 0; j < num2.size(); ++j) {
-        result[i + j] += num1[i] * num2[j] + temp;
-        temp = result[i + j] / ans.base_;
-        result[i + j] %= ans.base_;
+  // The low len limbs of x / 2^shift; x must have at least len + 1 limbs.
+  static vector<uint64_t> ShiftRight(const vector<uint64_t>& x, size_t len, int shift) {
+    vector<uint64_t> result(len, 0);
+    for (size_t i = 0; i < len; ++i) {
+      result[i] = x[i] >> shift;
+      if (shift != 0) result[i] |= x[i + 1] << (64 - shift);
+    }
+    return result;
+  }
+
+  // Knuth's Algorithm D (TAOCP 4.3.1): u / v for magnitudes with v non-zero,
+  // quotient and remainder returned through the last two arguments. Both
+  // operands are shifted so that v's top limb has its high bit set, which
+  // makes each two-limb estimate of a quotient limb at most two too large.
+  static void DivModLimbs(const vector<uint64_t>& u, const vector<uint64_t>& v,
+                          vector<uint64_t>& quotient, vector<uint64_t>& remainder) {
+    size_t n = v.size();
+    while (n > 0 && v[n - 1] == 0) --n;
+    size_t u_size = u.size();
+    while (u_size > 0 && u[u_size - 1] == 0) --u_size;
+    if (u_size < n) {
+      quotient.assign(1, 0);
+      remainder.assign(u.begin(), u.begin() + std::max<size_t>(u_size, 1));
+      return;
+    }
+    if (n == 1) {
+      quotient.assign(u.begin(), u.begin() + u_size);
+      unsigned __int128 rest = 0;
+      for (size_t i = u_size; i-- > 0;) {
+        unsigned __int128 current = (rest << 64) | quotient[i];
+        quotient[i] = static_cast<uint64_t>(current / v[0]);
+        rest = current % v[0];
       }
-      result[i + num2.size()] += temp;
+      remainder.assign(1, static_cast<uint64_t>(rest));
+      return;
     }
-    
-    ans.digits_ = std::move(result);
-    ans.removeLeadingZeros();
-    return ans;
+
+    size_t m = u_size - n;
+    int shift = __builtin_clzll(v[n - 1]);
+    vector<uint64_t> vn = ShiftLeft(v.data(), n, n, shift);
+    vector<uint64_t> un = ShiftLeft(u.data(), u_size, u_size + 1, shift);
+    quotient.assign(m + 1, 0);
+
+    const unsigned __int128 kLimb = static_cast<unsigned __int128>(1) << 64;
+    for (size_t j = m + 1; j-- > 0;) {
+      unsigned __int128 top = (static_cast<unsigned __int128>(un[j + n]) << 64) | un[j + n - 1];
+      unsigned __int128 q_hat = top / vn[n - 1];
+      unsigned __int128 r_hat = top % vn[n - 1];
+      while (q_hat >= kLimb ||
+             q_hat * vn[n - 2] > ((r_hat << 64) | un[j + n - 2])) {
+        --q_hat;
+        r_hat += vn[n - 1];
+        if (r_hat >= kLimb) break;
+      }
+
+      // un[j, j + n] -= q_hat * vn
+      uint64_t q = static_cast<uint64_t>(q_hat);
+      uint64_t carry = 0;
+      uint64_t borrow = 0;
+      for (size_t i = 0; i < n; ++i) {
+        unsigned __int128 product = static_cast<unsigned __int128>(q) * vn[i] + carry;
+        carry = static_cast<uint64_t>(product >> 64);
+        uint64_t low = static_cast<uint64_t>(product);
+        uint64_t diff = un[i + j] - low;
+        uint64_t next_borrow = un[i + j] < low;
+        next_borrow |= diff < borrow;
+        un[i + j] = diff - borrow;
+        borrow = next_borrow;
+      }
+      uint64_t top_sub = carry + borrow;
+      bool negative = un[j + n] < top_sub || top_sub < carry;
+      un[j + n] -= top_sub;
+
+      // The estimate was one too large: add vn back
+      if (negative) {
+        --q;
+        uint64_t add_carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+          uint64_t sum = un[i + j] + vn[i];
+          uint64_t next_carry = sum < vn[i];
+          un[i + j] = sum + add_carry;
+          add_carry = next_carry | (un[i + j] < add_carry);
+        }
+        un[j + n] += add_carry;
+      }
+      quotient[j] = q;
+    }
+
+    un.resize(n + 1);
+    remainder = ShiftRight(un, n, shift);
   }
 
-  BigInteger Divide(const BigInteger& first, const BigInteger& second) {
-    if (second == 0) {
-      throw std::runtime_error("Division by zero");
+  // Divisors of at least kNewtonThreshold limbs, with at least as many
+  // quotient limbs, are divided by multiplying with a reciprocal computed by
+  // Newton's iteration. A 2n / n division then costs about four n-limb
+  // products and follows the multiplication engine below quadratic; the
+  // threshold is the measured crossover with Algorithm D.
+  static const size_t kNewtonThreshold = 600;
+
+  // 2^(64 count).
+  static BigInteger LimbPower(size_t count) {
+    BigInteger result;
+    result.limbs_.assign(count + 1, 0);
+    result.limbs_.back() = 1;
+    return result;
+  }
+
+  // value / 2^(64 count), rounded toward zero.
+  static BigInteger DropLimbs(const BigInteger& value, size_t count) {
+    if (value.limbs_.size() <= count) return FromLimb(0);
+    BigInteger result = FromLimbs(value.limbs_.data() + count, value.limbs_.size() - count);
+    result.is_negative_ = value.is_negative_;
+    result.CheckForZero();
+    return result;
+  }
+
+  // About 2^(128 k) / a, for a of k limbs whose top bit is set, within a few
+  // units. The reciprocal x of the top h limbs, scaled by the remaining l
+  // limbs, is refined by one Newton step x += x (2^(128 k) - a x) / 2^(128 k),
+  // which doubles its correct limbs. With x scaled by 2^(64 l) that step is
+  // x e / 2^(128 h) for e = 2^(64 (2 k - l)) - a x, of which only the top
+  // limbs matter.
+  static BigInteger Reciprocal(const BigInteger& a) {
+    size_t k = a.limbs_.size();
+    if (k <= kNewtonThreshold) {
+      BigInteger result;
+      BigInteger rest;
+      DivModLimbs(LimbPower(2 * k).limbs_, a.limbs_, result.limbs_, rest.limbs_);
+      result.removeLeadingZeros();
+      return result;
     }
-    if (first == 0) {
-      return 0;
+    size_t low = k / 2;
+    size_t high = k - low;
+    BigInteger x = Reciprocal(FromLimbs(a.limbs_.data() + low, high));
+    BigInteger error = LimbPower(2 * k - low);
+    error -= Multiply(a, x);
+    BigInteger step = DropLimbs(Multiply(x, DropLimbs(error, high - 2)), high + 2);
+    x.limbs_.insert(x.limbs_.begin(), low, 0);
+    x += step;
+    return x;
+  }
+
+  // u / v through the reciprocal of v: u is cut into blocks of v's length
+  // from the top, and each block with the running remainder in front is
+  // less than v * 2^(64 n), so its quotient fits the block. The estimate
+  // from the top n + 1 limbs times the reciprocal is off by a few units,
+  // which the remainder corrects.
+  static void DivModNewton(const vector<uint64_t>& u, const vector<uint64_t>& v,
+                           vector<uint64_t>& quotient, vector<uint64_t>& remainder) {
+    size_t n = v.size();
+    int shift = __builtin_clzll(v.back());
+    BigInteger divisor;
+    divisor.limbs_ = ShiftLeft(v.data(), n, n, shift);
+    vector<uint64_t> un = ShiftLeft(u.data(), u.size(), u.size() + 1, shift);
+    BigInteger inverse = Reciprocal(divisor);
+
+    quotient.assign(un.size(), 0);
+    BigInteger rest = FromLimb(0);
+    for (size_t end = un.size(); end > 0;) {
+      size_t begin = end > n ? end - n : 0;
+      BigInteger part;
+      part.limbs_.assign(un.begin() + begin, un.begin() + end);
+      part.limbs_.insert(part.limbs_.end(), rest.limbs_.begin(), rest.limbs_.end());
+      part.removeLeadingZeros();
+
+      BigInteger q = DropLimbs(Multiply(DropLimbs(part, n - 1), inverse), n + 1);
+      rest = part;
+      rest -= Multiply(q, divisor);
+      while (rest.is_negative_) {
+        q -= 1;
+        rest += divisor;
+      }
+      while (!CompareByModul(rest, divisor)) {
+        q += 1;
+        rest -= divisor;
+      }
+      std::copy(q.limbs_.begin(), q.limbs_.end(), quotient.begin() + begin);
+      end = begin;
     }
-    if (first.abs() < second.abs()) return 0;
+    rest.limbs_.resize(n + 1);
+    remainder = ShiftRight(rest.limbs_, n, shift);
+  }
 
-    BigInteger ans;
-    if (first.is_negative_ == second.is_negative_) {
-      ans.is_negative_ = false;
+  // Truncating division: the quotient rounds toward zero and the remainder
+  // takes the sign of the dividend.
+  static void DivMod(const BigInteger& first, const BigInteger& second, BigInteger& quotient,
+                     BigInteger& remainder) {
+    if (second.limbs_.empty() || (second.limbs_.size() == 1 && second.limbs_[0] == 0)) {
+      throw std::runtime_error("Division by zero");
+    }
+    if (first.limbs_.empty() || CompareByModul(first, second)) {
+      remainder = first;
+      quotient = FromLimb(0);
+      return;
+    }
+    size_t n = second.limbs_.size();
+    if (n >= kNewtonThreshold && first.limbs_.size() - n >= kNewtonThreshold) {
+      DivModNewton(first.limbs_, second.limbs_, quotient.limbs_, remainder.limbs_);
     } else {
-      ans.is_negative_ = true;
-    }
-    BigInteger temp;
-
-    BigInteger divised = first.abs();
-    BigInteger divisior = second.abs();
-
-    for (int64_t i = divised.digits_.size() - 1; i >= 0; --i) {
-      temp.digits_.insert(temp.digits_.begin(), divised.digits_[i]);
-      temp.removeLeadingZeros();
-      int64_t l = 0;
-      int64_t r = temp.base_;
-      int64_t x = 0;
-      
-      while (l <= r) {
-        int64_t m = (l + r) / 2;
-        BigInteger t = Multiply(divisior, m);
-        if (t < temp || t == temp) {
-          x = m;
-          l = m + 1;
-        } else {
-          r = m - 1;
+      DivModLimbs(first.limbs_, second.limbs_, quotient.limbs_, remainder.limbs_);
+    }
+    quotient.is_negative_ = first.is_negative_ != second.is_negative_;
+    remainder.is_negative_ = first.is_negative_;
+    quotient.removeLeadingZeros();
+    remainder.removeLeadingZeros();
+  }
+
+  // Conversions between limbs and decimal split the number at 10^(19 * 2^k)
+  // and recurse on both halves, so that with fast multiplication and division
+  // they are far below quadratic. Pieces of up to kConversionBasecase limbs
+  // are converted one limb-sized chunk of digits at a time.
+  static const size_t kConversionBasecase = 24;
+
+  // 10^(kDecimalDigits * 2^level), squared into a per-thread cache on demand.
+  static const BigInteger& DecimalPower(size_t level) {
+    thread_local vector<BigInteger> powers;
+    if (powers.empty()) powers.push_back(FromLimb(kDecimalBase));
+    while (powers.size() <= level) {
+      powers.push_back(Multiply(powers.back(), powers.back()));
+    }
+    return powers[level];
+  }
+
+  // Writes the magnitude of value as exactly 'width' digits, zero-padded.
+  static void WriteDecimal(const BigInteger& value, size_t level, char* out, size_t width) {
+    if (value.limbs_.size() <= kConversionBasecase || level == 0) {
+      BigInteger rest = value;
+      char* pos = out + width;
+      while (pos != out && (rest.limbs_.size() > 1 || rest.limbs_[0] != 0)) {
+        uint64_t chunk = rest.DivideByLimb(kDecimalBase);
+        for (int i = 0; i < kDecimalDigits && pos != out; ++i) {
+          *--pos = static_cast<char>('0' + chunk % 10);
+          chunk /= 10;
         }
       }
-      ans.digits_.push_back(x);
-      temp -= Multiply(divisior, x);
+      std::fill(out, pos, '0');
+      return;
     }
-    std::reverse(ans.digits_.begin(), ans.digits_.end());
-    ans.removeLeadingZeros();
-    return ans;
+    // value < 10^(19 * 2^level): the low half gets 19 * 2^(level - 1) digits
+    size_t low_width = static_cast<size_t>(kDecimalDigits) << (level - 1);
+    BigInteger high;
+    BigInteger low;
+    DivMod(value, DecimalPower(level - 1), high, low);
+    WriteDecimal(high, level - 1, out, width - low_width);
+    WriteDecimal(low, level - 1, out + width - low_width, low_width);
+  }
+
+  // Magnitude of the decimal digits in [digits, digits + len).
+  static BigInteger ParseDecimal(const char* digits, size_t len) {
+    if (len <= kConversionBasecase * kDecimalDigits) {
+      BigInteger result = FromLimb(0);
+      size_t chunk = len % kDecimalDigits;
+      if (chunk == 0) chunk = kDecimalDigits;
+      for (size_t i = 0; i < len; i += chunk, chunk = kDecimalDigits) {
+        uint64_t value = 0;
+        uint64_t scale = 1;
+        for (size_t j = i; j < i + chunk; ++j) {
+          value = value * 10 + (digits[j] - '0');
+          scale *= 10;
+        }
+        result.MultiplyAddLimb(scale, value);
+      }
+      result.removeLeadingZeros();
+      return result;
+    }
+    // Largest split 19 * 2^level strictly below len
+    size_t level = 0;
+    while ((static_cast<size_t>(kDecimalDigits) << (level + 1)) < len) ++level;
+    size_t low_len = static_cast<size_t>(kDecimalDigits) << level;
+    BigInteger result = Multiply(ParseDecimal(digits, len - low_len), DecimalPower(level));
+    BigInteger low = ParseDecimal(digits + len - low_len, low_len);
+    if (result.limbs_.empty()) result.limbs_.push_back(0);
+    result.limbs_.resize(std::max(result.limbs_.size(), low.limbs_.size()) + 1);
+    AddLimbs(result.limbs_, low.limbs_.data(), low.limbs_.size(), 0);
+    result.removeLeadingZeros();
+    return result;
   }
 
  public:
   BigInteger(int64_t x) {
-    if (x == 0) {
-      digits_.push_back(0);
-    }
     if (x < 0) {
       is_negative_ = true;
-      x = std::abs(x);
-    }
-    while(x > 0) {
-      digits_.push_back(x % base_);
-      x /= base_;
     }
+    // Negating in unsigned arithmetic also covers INT64_MIN
+    uint64_t magnitude = x < 0 ? uint64_t(0) - static_cast<uint64_t>(x) : x;
+    limbs_.push_back(magnitude);
   }
 
   BigInteger(const BigInteger& other) = default;
 
   BigInteger(const std::string s, size_t size) {
-    int64_t temp = 0;
-    int64_t start = 0;
+    size_t start = 0;
     if (size == 0) {
       is_negative_ = false;
     } else {
       if (s[start] == '-') {
         ++start;
-        is_negative_ = true;
-        if (s[start] == '0' && size - start == 1) {
-          is_negative_ = false;
-        }
-      } else {
-        is_negative_ = false;
-      }
-      int64_t len = 1;
-      for (int64_t i = size - 1; i >= start; --i) {
-        if (len == base_) {
-          len = 1;
-          digits_.push_back(temp);
-          temp = 0;
-        }
-        temp += (s[i] - '0') * len;
-        len *= 10;
       }
-      digits_.push_back(temp);
+      limbs_ = ParseDecimal(s.data() + start, size - start).limbs_;
+      is_negative_ = start == 1;
       removeLeadingZeros();
     }
   }
@@ -232,20 +748,24 @@ class BigInteger {
   }
 
   explicit operator bool() const {
-    return !(digits_.size() == 1 && digits_[0] == 0);
+    return !(limbs_.size() == 1 && limbs_[0] == 0);
   }
 
+  // Digits are written straight into the result string: the smallest
+  // 19 * 2^level wide field that fits the value, then leading zeros trimmed.
   std::string toString() const {
-    if (digits_.empty()) {
+    if (limbs_.empty()) {
       return "0";
     }
-    std::ostringstream oss;
-    if (is_negative_)
-      oss << '-';
-    oss << digits_.back();
-    for (int64_t i = static_cast<int64_t>(digits_.size()) - 2; i >= 0; --i)
-      oss << std::setw(n_digits_) << std::setfill('0') << digits_[i];
-    return oss.str();
+    size_t level = 0;
+    while (DecimalPower(level).limbs_.size() <= limbs_.size()) ++level;
+    size_t width = static_cast<size_t>(kDecimalDigits) << level;
+    std::string result(width + 1, '-');
+    WriteDecimal(abs(), level, result.data() + 1, width);
+    size_t first = result.find_first_not_of('0', 1);
+    if (first == std::string::npos) return "0";
+    result.erase(is_negative_ ? 1 : 0, first - (is_negative_ ? 1 : 0));
+    return result;
   }
 
   BigInteger& operator+=(const BigInteger& other) {
@@ -276,13 +796,24 @@ class BigInteger {
     return *this;
   }
 
+  static BigInteger MultiplyUsing(const BigInteger& first, const BigInteger& second,
+                                  Multiplication method) {
+    return Multiply(first, second, method);
+  }
+
   BigInteger& operator/=(const BigInteger& other) {
-    *this = Divide(*this, other);
+    BigInteger quotient;
+    BigInteger remainder;
+    DivMod(*this, other, quotient, remainder);
+    *this = std::move(quotient);
     return *this;
   }
 
   BigInteger& operator%=(const BigInteger& other) {
-    *this -= Multiply(Divide(*this, other), other);
+    BigInteger quotient;
+    BigInteger remainder;
+    DivMod(*this, other, quotient, remainder);
+    *this = std::move(remainder);
     return *this;
   }
 
@@ -296,15 +827,15 @@ class BigInteger {
   }
 
   static bool CompareByModul(const BigInteger& first, const BigInteger& second) {
-    if (first.digits_.size() < second.digits_.size()) {
+    if (first.limbs_.size() < second.limbs_.size()) {
       return true;
     }
-    if (first.digits_.size() > second.digits_.size()) {
+    if (first.limbs_.size() > second.limbs_.size()) {
       return false;
     }
-    for (int64_t i = first.digits_.size() - 1; i >= 0; --i) {
-      int64_t x = first.digits_[i];
-      int64_t y = second.digits_[i];
+    for (int64_t i = first.limbs_.size() - 1; i >= 0; --i) {
+      uint64_t x = first.limbs_[i];
+      uint64_t y = second.limbs_[i];
       if (x < y) {
         return true;
       } else if (x > y){
@@ -410,12 +941,11 @@ BigInteger gcd(const BigInteger& first, const BigInteger& second) {
     a = second.abs();
     b = first.abs();
   }
-  BigInteger r;
-  do {
-    r = a % b;
-    a = b;
-    b = r;
-  } while (r != 0);
+  while (b != 0) {
+    BigInteger r = a % b;
+    a = std::move(b);
+    b = std::move(r);
+  }
   return a;
 }
 
@@ -0,0 +1,165 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "biginteger.h"
+
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+template <typename Clock = std::chrono::high_resolution_clock>
+class Timer {
+    typename Clock::time_point start_ = Clock::now();
+
+public:
+    double Ms() const {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+    }
+};
+
+std::string RandomDigits(size_t digits, std::mt19937_64& rng) {
+    std::string number(1, static_cast<char>('1' + rng() % 9));
+    while (number.size() < digits) {
+        number += static_cast<char>('0' + rng() % 10);
+    }
+    return number;
+}
+
+// Average milliseconds per product, repeated until at least ~50 ms have passed
+double TimeProduct(const BigInteger& first, const BigInteger& second,
+                   BigInteger::Multiplication method) {
+    size_t repeats = 0;
+    Timer<> timer;
+    do {
+        BigInteger product = BigInteger::MultiplyUsing(first, second, method);
+        ++repeats;
+    } while (timer.Ms() < 50);
+    return timer.Ms() / repeats;
+}
+
+// Times every method on balanced operands of growing size. The fastest
+// method per row shows where the kAuto thresholds should sit; methods that
+// are hopeless at a size are skipped.
+void BenchmarkCrossovers() {
+    using Method = BigInteger::Multiplication;
+    struct Column {
+        const char* name;
+        Method method;
+        size_t max_digits;
+    };
+    const Column columns[] = {
+        {"schoolbook", Method::kSchoolbook, 200'000},
+        {"karatsuba", Method::kKaratsuba, 2'000'000},
+        {"toom3", Method::kToom3, 2'000'000},
+        {"ntt", Method::kNtt, 10'000'000},
+        {"auto", Method::kAuto, 10'000'000},
+    };
+
+    std::cerr << "Multiplication crossovers (ms per product):" << std::endl;
+    std::cerr << "  digits";
+    for (const Column& column : columns) {
+        std::cerr << '\t' << column.name;
+    }
+    std::cerr << "\tfastest" << std::endl;
+
+    std::mt19937_64 rng(2024);
+    for (size_t digits = 1000; digits <= 4'000'000; digits *= 2) {
+        BigInteger first(RandomDigits(digits, rng));
+        BigInteger second(RandomDigits(digits, rng));
+        std::cerr << "  " << digits;
+        double best = 0;
+        const char* fastest = "";
+        for (const Column& column : columns) {
+            if (digits > column.max_digits) {
+                std::cerr << "\t-";
+                continue;
+            }
+            double ms = TimeProduct(first, second, column.method);
+            std::cerr << '\t' << ms;
+            if (column.method != Method::kAuto && (best == 0 || ms < best)) {
+                best = ms;
+                fastest = column.name;
+            }
+        }
+        std::cerr << '\t' << fastest << std::endl;
+    }
+}
+
+void BenchmarkFactorial() {
+    const int n = 20'000;
+    Timer<> timer;
+    BigInteger factorial = 1;
+    for (int i = 2; i <= n; ++i) {
+        factorial *= i;
+    }
+    double ms = timer.Ms();
+    std::cerr << "Factorial " << n << "! by repeated *=: " << ms << " ms" << std::endl;
+
+    // Balanced product tree, where the fast methods pay off
+    timer = Timer<>();
+    std::vector<BigInteger> level;
+    for (int i = 1; i <= n; ++i) {
+        level.push_back(i);
+    }
+    while (level.size() > 1) {
+        std::vector<BigInteger> next;
+        for (size_t i = 0; i + 1 < level.size(); i += 2) {
+            next.push_back(level[i] * level[i + 1]);
+        }
+        if (level.size() % 2 == 1) {
+            next.push_back(level.back());
+        }
+        level.swap(next);
+    }
+    ms = timer.Ms();
+    assert(level.front() == factorial);
+    std::cerr << "Factorial " << n << "! by product tree: " << ms << " ms" << std::endl;
+}
+
+void BenchmarkConversion() {
+    std::mt19937_64 rng(24);
+    std::cerr << "digits\tparse ms\ttoString ms" << std::endl;
+    for (size_t digits : {1'000, 10'000, 100'000, 1'000'000}) {
+        std::string text = RandomDigits(digits, rng);
+        Timer<> timer;
+        BigInteger number(text);
+        double parse_ms = timer.Ms();
+        timer = Timer<>();
+        std::string back = number.toString();
+        double print_ms = timer.Ms();
+        assert(back == text);
+        std::cerr << digits << '\t' << parse_ms << '\t' << print_ms << std::endl;
+    }
+}
+
+// 2n-digit by n-digit quotient and remainder, and gcd of two n-digit numbers
+void BenchmarkDivision() {
+    std::mt19937_64 rng(25);
+    std::cerr << "digits\tdivide ms\tgcd ms" << std::endl;
+    for (size_t digits : {1'000, 10'000, 100'000, 1'000'000}) {
+        BigInteger dividend(RandomDigits(2 * digits, rng));
+        BigInteger divisor(RandomDigits(digits, rng));
+        Timer<> timer;
+        BigInteger quotient = dividend / divisor;
+        BigInteger remainder = dividend % divisor;
+        double divide_ms = timer.Ms();
+        assert(quotient * divisor + remainder == dividend);
+        std::cerr << digits << '\t' << divide_ms;
+        if (digits <= 10'000) {
+            BigInteger other(RandomDigits(digits, rng));
+            timer = Timer<>();
+            BigInteger divisor_gcd = gcd(divisor, other);
+            std::cerr << '\t' << timer.Ms();
+        }
+        std::cerr << std::endl;
+    }
+}
+
+int main() {
+    BenchmarkCrossovers();
+    BenchmarkFactorial();
+    BenchmarkConversion();
+    BenchmarkDivision();
+}
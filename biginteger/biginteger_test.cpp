@@ -0,0 +1,250 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "biginteger.h"
+
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using Method = BigInteger::Multiplication;
+
+const BigInteger kLimb("18446744073709551616");
+
+std::string RandomDigits(size_t digits, std::mt19937_64& rng) {
+    std::string number(1, static_cast<char>('1' + rng() % 9));
+    while (number.size() < digits) {
+        number += static_cast<char>('0' + rng() % 10);
+    }
+    return number;
+}
+
+// Little-endian limbs: the top one as given, the rest random, or all zero or
+// all ones when pattern is 0 or 1
+BigInteger FromLimbs(size_t limbs, uint64_t top, int pattern, std::mt19937_64& rng) {
+    BigInteger number(0);
+    for (size_t i = limbs; i-- > 0;) {
+        uint64_t limb = i + 1 == limbs ? top : pattern == 0 ? 0 : pattern == 1 ? ~uint64_t(0) : rng();
+        number *= kLimb;
+        number += BigInteger(static_cast<int64_t>(limb >> 1)) * 2 + static_cast<int64_t>(limb & 1);
+    }
+    return number;
+}
+
+void CheckDivision(const BigInteger& dividend, const BigInteger& divisor) {
+    BigInteger quotient = dividend / divisor;
+    BigInteger remainder = dividend % divisor;
+    assert(quotient * divisor + remainder == dividend);
+    assert(remainder.abs() < divisor.abs());
+    assert(remainder == 0 || remainder.IsNegative() == dividend.IsNegative());
+}
+
+std::string ToString(__int128 value) {
+    if (value == 0) return "0";
+    bool negative = value < 0;
+    unsigned __int128 magnitude = negative ? -static_cast<unsigned __int128>(value) : value;
+    std::string digits;
+    for (; magnitude != 0; magnitude /= 10) {
+        digits.insert(digits.begin(), static_cast<char>('0' + magnitude % 10));
+    }
+    return negative ? "-" + digits : digits;
+}
+
+// Numbers of 1 to 3 limbs: all ones, a single high bit, and mixed limbs
+std::vector<BigInteger> TinyOperands() {
+    std::vector<BigInteger> operands;
+    BigInteger power = 1;
+    for (int limbs = 1; limbs <= 3; ++limbs) {
+        power *= kLimb;
+        operands.push_back(power - 1);
+        operands.push_back(power / kLimb);
+        operands.push_back(power / 3 + 12345);
+    }
+    operands.push_back(-7);
+    return operands;
+}
+
+// Every forced method against schoolbook, on operands of a few limbs, where
+// the splitting methods have almost nothing to split, and on large ones
+void TestForcedMultiplication() {
+    const Method methods[] = {Method::kKaratsuba, Method::kToom3, Method::kNtt, Method::kAuto};
+    std::vector<BigInteger> tiny = TinyOperands();
+    for (const BigInteger& first : tiny) {
+        for (const BigInteger& second : tiny) {
+            BigInteger expected = BigInteger::MultiplyUsing(first, second, Method::kSchoolbook);
+            for (Method method : methods) {
+                assert(BigInteger::MultiplyUsing(first, second, method) == expected);
+            }
+        }
+    }
+
+    std::mt19937_64 rng(1);
+    const size_t sizes[][2] = {{20'000, 20'000}, {30'000, 11'000}, {50'000, 1'000}, {150'000, 150'000}};
+    for (const auto& size : sizes) {
+        BigInteger first(RandomDigits(size[0], rng));
+        BigInteger second(RandomDigits(size[1], rng));
+        BigInteger expected = BigInteger::MultiplyUsing(first, second, Method::kSchoolbook);
+        for (Method method : methods) {
+            assert(BigInteger::MultiplyUsing(first, second, method) == expected);
+            assert(BigInteger::MultiplyUsing(-first, second, method) == -expected);
+        }
+    }
+}
+
+// Divisors whose top limb is 1 or all ones, the extremes of normalization,
+// on both sides of the Algorithm D / Newton switch at 600 limbs of divisor
+// and quotient, plus the single-limb path
+void TestDivision() {
+    std::mt19937_64 rng(25);
+    const uint64_t tops[] = {1, ~uint64_t(0), uint64_t(1) << 63, 0x123456789};
+    const size_t divisor_sizes[] = {1, 2, 3, 599, 600, 601};
+    const size_t quotient_sizes[] = {1, 2, 599, 600, 601, 1300};
+    for (size_t divisor_limbs : divisor_sizes) {
+        for (size_t quotient_limbs : quotient_sizes) {
+            for (uint64_t top : tops) {
+                int pattern = static_cast<int>(rng() % 3);
+                BigInteger divisor = FromLimbs(divisor_limbs, top, pattern, rng);
+                BigInteger dividend = FromLimbs(divisor_limbs + quotient_limbs, ~top | 1, 2, rng);
+                CheckDivision(dividend, divisor);
+                CheckDivision(-dividend, divisor);
+                CheckDivision(dividend, -divisor);
+            }
+        }
+    }
+
+    // Exact multiples and one below them, where every quotient estimate is
+    // tight
+    for (size_t limbs : {2, 600, 700}) {
+        BigInteger divisor = FromLimbs(limbs, ~uint64_t(0), 1, rng);
+        BigInteger quotient = FromLimbs(limbs + 5, 1, 1, rng);
+        BigInteger product = divisor * quotient;
+        assert(product / divisor == quotient && product % divisor == 0);
+        assert((product - 1) / divisor == quotient - 1);
+        assert((product - 1) % divisor == divisor - 1);
+        CheckDivision(product + divisor - 1, divisor);
+    }
+
+    assert(BigInteger(7) / BigInteger(9) == 0 && BigInteger(-7) % BigInteger(9) == -7);
+    assert(BigInteger(-7) / BigInteger(2) == -3 && BigInteger(-7) % BigInteger(2) == -1);
+    bool threw = false;
+    try {
+        BigInteger(1) / BigInteger(0);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    BigInteger self = FromLimbs(700, 5, 2, rng);
+    self /= self;
+    assert(self == 1);
+}
+
+void TestGcd() {
+    std::mt19937_64 rng(9);
+    assert(gcd(BigInteger(0), BigInteger(-8)) == 8 && gcd(BigInteger(12), BigInteger(0)) == 12);
+    assert(gcd(BigInteger(-12), BigInteger(18)) == 6);
+    BigInteger common(RandomDigits(2000, rng));
+    BigInteger first = common * BigInteger(RandomDigits(2000, rng));
+    BigInteger second = common * BigInteger(RandomDigits(1900, rng));
+    BigInteger divisor = gcd(first, second);
+    assert(divisor % common == 0);
+    assert(gcd(first / divisor, second / divisor) == 1);
+}
+
+// Decimal text survives parsing and printing unchanged around the sizes
+// where conversion switches from limb-by-limb to splitting at 10^(19 * 2^k),
+// with runs of zeros that the zero-padded halves must keep
+void TestDecimalRoundTrip() {
+    std::mt19937_64 rng(24);
+    const size_t lengths[] = {1, 18, 19, 20, 38, 455, 456, 457, 912, 913, 1000, 9000, 12000, 40000};
+    for (size_t length : lengths) {
+        for (int variant = 0; variant < 4; ++variant) {
+            std::string text = RandomDigits(length, rng);
+            if (variant == 1) {
+                text.replace(length / 3, length / 3, length / 3, '0');
+            } else if (variant == 2) {
+                text = "1" + std::string(length - 1, '0');
+            } else if (variant == 3) {
+                text = std::string(length, '9');
+            }
+            assert(BigInteger(text).toString() == text);
+            assert(BigInteger("-" + text).toString() == "-" + text);
+        }
+    }
+    assert(BigInteger("0").toString() == "0" && BigInteger("-0").toString() == "0");
+    assert(BigInteger("000123").toString() == "123");
+
+    std::ostringstream out;
+    BigInteger number("-98765432109876543210987654321");
+    out << number * number;
+    std::istringstream in(out.str());
+    BigInteger parsed;
+    in >> parsed;
+    assert(parsed == number * number);
+    assert(BigInteger(int64_t(INT64_MIN)).toString() == "-9223372036854775808");
+}
+
+// Arithmetic on values around the 2^64 limb boundary against __int128
+void TestLimbBoundaries() {
+    std::vector<__int128> values;
+    const __int128 limb = static_cast<__int128>(1) << 64;
+    for (__int128 base : {static_cast<__int128>(0), limb, static_cast<__int128>(INT64_MAX)}) {
+        for (int delta = -2; delta <= 2; ++delta) {
+            values.push_back(base + delta);
+            values.push_back(-(base + delta));
+        }
+    }
+    values.push_back(limb * 12345 + 678);
+    for (__int128 first : values) {
+        for (__int128 second : values) {
+            BigInteger a(ToString(first));
+            BigInteger b(ToString(second));
+            assert((a + b).toString() == ToString(first + second));
+            assert((a - b).toString() == ToString(first - second));
+            assert((a < b) == (first < second) && (a == b) == (first == second));
+            __int128 product;
+            if (!__builtin_mul_overflow(first, second, &product)) {
+                assert((a * b).toString() == ToString(product));
+            }
+            if (second != 0) {
+                assert((a / b).toString() == ToString(first / second));
+                assert((a % b).toString() == ToString(first % second));
+            }
+        }
+    }
+}
+
+// Automatic dispatch on both sides of the Karatsuba (48 limbs) and Toom-3
+// (300 limbs) thresholds, balanced and unbalanced, including operands of
+// all-ones limbs where every carry propagates
+void TestMultiplicationThresholds() {
+    std::mt19937_64 rng(21);
+    const size_t sizes[] = {47, 48, 49, 96, 299, 300, 301, 700};
+    for (size_t first_limbs : sizes) {
+        for (size_t second_limbs : {size_t(1), size_t(47), size_t(49), size_t(300), first_limbs}) {
+            for (int pattern : {1, 2}) {
+                BigInteger first = FromLimbs(first_limbs, ~uint64_t(0), pattern, rng);
+                BigInteger second = FromLimbs(second_limbs, ~uint64_t(0), pattern, rng);
+                BigInteger expected = BigInteger::MultiplyUsing(first, second, Method::kSchoolbook);
+                assert(first * second == expected);
+                assert(second * first == expected);
+            }
+        }
+    }
+}
+
+int main() {
+    TestLimbBoundaries();
+    std::cerr << "TestLimbBoundaries passed" << std::endl;
+    TestForcedMultiplication();
+    std::cerr << "TestForcedMultiplication passed" << std::endl;
+    TestDivision();
+    std::cerr << "TestDivision passed" << std::endl;
+    TestGcd();
+    std::cerr << "TestGcd passed" << std::endl;
+    TestDecimalRoundTrip();
+    std::cerr << "TestDecimalRoundTrip passed" << std::endl;
+    TestMultiplicationThresholds();
+    std::cerr << "TestMultiplicationThresholds passed" << std::endl;
+}
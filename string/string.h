@@ -1,243 +1,2834 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <compare>
+#include <condition_variable>
 #include <cstring>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
-class String {
-  size_t cap_;
-  size_t len_;
-  char* str_;
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STRING_SEARCH_X86
+#endif
 
-  void increase_cap(size_t new_cap) {
-    if (new_cap <= cap_) return;
-    cap_ = std::max(new_cap, cap_ * 2);
-    char* new_str = new char[cap_ + 1];
-    std::copy(str_, str_ + len_, new_str);
-    new_str[len_] = '\0';
-    delete[] str_;
-    str_ = new_str;
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define STRING_HAS_MMAP
+#endif
+
+// Substring search used by String::find and String::rfind. Every function
+// returns the offset of the match, or n when there is none. Short needles go
+// through a SIMD filter on the first and last needle bytes, long needles
+// through Boyer-Moore-Horspool which skips ahead by up to the needle length.
+namespace string_search {
+
+static const size_t kHorspoolMinNeedle = 32;
+
+inline bool matches(const char* pos, const char* needle, size_t m) {
+  return m <= 2 || memcmp(pos + 1, needle + 1, m - 2) == 0;
+}
+
+inline size_t find_scalar(const char* hay, size_t n, size_t from,
+                          const char* needle, size_t m) {
+  for (size_t i = from; i + m <= n; ++i) {
+    const void* p = memchr(hay + i, needle[0], n - m + 1 - i);
+    if (!p) break;
+    i = static_cast<const char*>(p) - hay;
+    if (hay[i + m - 1] == needle[m - 1] && matches(hay + i, needle, m)) {
+      return i;
+    }
   }
+  return n;
+}
 
+// Checks candidates [0, to) from right to left.
+inline size_t rfind_scalar(const char* hay, size_t n, size_t to,
+                           const char* needle, size_t m) {
+  for (size_t i = to; i-- > 0;) {
+    if (hay[i] == needle[0] && hay[i + m - 1] == needle[m - 1] &&
+        matches(hay + i, needle, m)) {
+      return i;
+    }
+  }
+  return n;
+}
 
-public:
-  String(const char c)
-  : cap_(1)
-  , len_(1)
-  , str_(new char[cap_ + 1])
-  {
-    str_[0] = c;
-    str_[len_] = '\0';
+// Bad-character shifts of find_horspool. Callers searching one haystack for
+// the same needle again and again build them once.
+inline void horspool_shifts(const char* needle, size_t m, size_t shift[256]) {
+  std::fill(shift, shift + 256, m);
+  for (size_t j = 0; j + 1 < m; ++j) {
+    shift[static_cast<unsigned char>(needle[j])] = m - 1 - j;
   }
+}
 
-  String(size_t len_, char c)
-  : cap_(len_)
-  , len_(len_)
-  , str_(new char[cap_ + 1])
-  {
-    std::fill(str_, str_ + len_, c);
-    str_[len_] = '\0';
+// Checks candidates [from, n - m] with prebuilt shifts.
+inline size_t find_horspool(const char* hay, size_t n, size_t from, const char* needle,
+                            size_t m, const size_t shift[256]) {
+  const char last = needle[m - 1];
+  for (size_t i = from; i + m <= n;) {
+    char c = hay[i + m - 1];
+    if (c == last && memcmp(hay + i, needle, m - 1) == 0) {
+      return i;
+    }
+    i += shift[static_cast<unsigned char>(c)];
   }
+  return n;
+}
 
-  String(const char* string)
-  : cap_(strlen(string))
-  , len_(strlen(string))
-  , str_(new char[cap_ + 1])
-  {
-    strcpy(str_, string);
-    str_[len_] = '\0';
+inline size_t find_horspool(const char* hay, size_t n, const char* needle, size_t m) {
+  size_t shift[256];
+  horspool_shifts(needle, m, shift);
+  return find_horspool(hay, n, 0, needle, m, shift);
+}
+
+// Mirror image of find_horspool: the window is anchored on its first byte.
+inline size_t rfind_horspool(const char* hay, size_t n, const char* needle, size_t m) {
+  size_t shift[256];
+  std::fill(shift, shift + 256, m);
+  for (size_t j = m - 1; j > 0; --j) {
+    shift[static_cast<unsigned char>(needle[j])] = j;
+  }
+  const char first = needle[0];
+  size_t i = n - m;
+  while (true) {
+    char c = hay[i];
+    if (c == first && memcmp(hay + i + 1, needle + 1, m - 1) == 0) {
+      return i;
+    }
+    size_t step = shift[static_cast<unsigned char>(c)];
+    if (i < step) break;
+    i -= step;
   }
+  return n;
+}
 
-  String(const String& other)
-  : cap_(other.cap_)
-  , len_(other.len_)
-  , str_(new char[cap_ + 1])
-  {
-    std::copy(other.str_, other.str_ + other.len_, str_);
-    str_[len_] = '\0';
+#ifdef STRING_SEARCH_X86
+
+inline size_t find_sse2(const char* hay, size_t n, const char* needle, size_t m) {
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[m - 1]);
+  size_t i = 0;
+  for (; i + m + 15 <= n; i += 16) {
+    __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+    __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + m - 1));
+    unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                    _mm_cmpeq_epi8(block_last, last)));
+    while (mask != 0) {
+      size_t pos = i + __builtin_ctz(mask);
+      if (matches(hay + pos, needle, m)) return pos;
+      mask &= mask - 1;
+    }
   }
+  return find_scalar(hay, n, i, needle, m);
+}
 
-  String() : cap_(0), len_(0), str_(new char[1]) {
-    str_[0] = '\0';
+inline size_t rfind_sse2(const char* hay, size_t n, const char* needle, size_t m) {
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[m - 1]);
+  size_t end = n - m + 1;
+  for (; end >= 16; end -= 16) {
+    size_t i = end - 16;
+    __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+    __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + m - 1));
+    unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                    _mm_cmpeq_epi8(block_last, last)));
+    while (mask != 0) {
+      size_t bit = 31 - __builtin_clz(mask);
+      if (matches(hay + i + bit, needle, m)) return i + bit;
+      mask &= ~(1u << bit);
+    }
   }
+  return rfind_scalar(hay, n, end, needle, m);
+}
 
-  ~String() {
-    delete[] str_;
+__attribute__((target("avx2")))
+inline size_t find_avx2(const char* hay, size_t n, const char* needle, size_t m) {
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+  size_t i = 0;
+  for (; i + m + 31 <= n; i += 32) {
+    __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i));
+    __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i + m - 1));
+    unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                                          _mm256_cmpeq_epi8(block_last, last)));
+    while (mask != 0) {
+      size_t pos = i + __builtin_ctz(mask);
+      if (matches(hay + pos, needle, m)) return pos;
+      mask &= mask - 1;
+    }
   }
+  return find_scalar(hay, n, i, needle, m);
+}
 
-  String& operator=(const String& other) {
-    if (this != &other) {
-      delete[] str_;
-      cap_ = other.len_;
-      len_ = other.len_;
-      str_ = new char[other.len_ + 1];
-      if (other.str_) {
-        std::copy(other.str_, other.str_ + other.len_, str_);
-      }
-      str_[len_] = '\0';
+__attribute__((target("avx2")))
+inline size_t rfind_avx2(const char* hay, size_t n, const char* needle, size_t m) {
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+  size_t end = n - m + 1;
+  for (; end >= 32; end -= 32) {
+    size_t i = end - 32;
+    __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i));
+    __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i + m - 1));
+    unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                                          _mm256_cmpeq_epi8(block_last, last)));
+    while (mask != 0) {
+      size_t bit = 31 - __builtin_clz(mask);
+      if (matches(hay + i + bit, needle, m)) return i + bit;
+      mask &= ~(1u << bit);
     }
-    return *this;
   }
+  return rfind_scalar(hay, n, end, needle, m);
+}
 
-  char& operator[](size_t ind) { return str_[ind]; }
+#endif
 
-  const char& operator[](size_t ind) const { return str_[ind]; }
+using SearchFn = size_t (*)(const char*, size_t, const char*, size_t);
 
-  size_t length() const { return len_; }
+inline bool has_avx2() {
+#ifdef STRING_SEARCH_X86
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+#else
+  return false;
+#endif
+}
 
-  size_t size() const { return length(); }
+inline size_t find(const char* hay, size_t n, const char* needle, size_t m) {
+  if (m == 0 || m > n) return n;
+  if (m >= kHorspoolMinNeedle) return find_horspool(hay, n, needle, m);
+#ifdef STRING_SEARCH_X86
+  static const SearchFn simd = has_avx2() ? find_avx2 : find_sse2;
+  return simd(hay, n, needle, m);
+#else
+  return find_scalar(hay, n, 0, needle, m);
+#endif
+}
+
+inline size_t rfind(const char* hay, size_t n, const char* needle, size_t m) {
+  if (m == 0 || m > n) return n;
+  if (m >= kHorspoolMinNeedle) return rfind_horspool(hay, n, needle, m);
+#ifdef STRING_SEARCH_X86
+  static const SearchFn simd = has_avx2() ? rfind_avx2 : rfind_sse2;
+  return simd(hay, n, needle, m);
+#else
+  return rfind_scalar(hay, n, n - m + 1, needle, m);
+#endif
+}
 
-  size_t capacity() const { return cap_; }
 
-  void push_back(char c) {
-    increase_cap(len_ + 1);
-    str_[len_] = c;
-    ++len_;
-    str_[len_] = '\0';
+// Calls callback with the offset of every occurrence of c, in increasing
+// order. The vector loops compare whole blocks against c and walk the set bits
+// of the resulting mask, so dense delimiters cost no extra calls or branches
+// per byte.
+template <typename Callback>
+void for_each_char_scalar(const char* str, size_t from, size_t n, char c, Callback& callback) {
+  for (size_t i = from; i < n; ++i) {
+    if (str[i] == c) callback(i);
   }
+}
 
-  void pop_back() {
-    if (len_ > 0) {
-      --len_;
-      str_[len_] = '\0';
+#ifdef STRING_SEARCH_X86
+
+template <typename Callback>
+void for_each_char_sse2(const char* str, size_t n, char c, Callback& callback) {
+  const __m128i needle = _mm_set1_epi8(c);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    while (mask != 0) {
+      callback(i + __builtin_ctz(mask));
+      mask &= mask - 1;
     }
   }
+  for_each_char_scalar(str, i, n, c, callback);
+}
 
-  const char& front() const { return str_[0]; }
+template <typename Callback>
+__attribute__((target("avx2")))
+void for_each_char_avx2(const char* str, size_t n, char c, Callback& callback) {
+  const __m256i needle = _mm256_set1_epi8(c);
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i + 32));
+    uint64_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, needle))) |
+                    static_cast<uint64_t>(static_cast<uint32_t>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(high, needle)))) << 32;
+    while (mask != 0) {
+      callback(i + __builtin_ctzll(mask));
+      mask &= mask - 1;
+    }
+  }
+  for_each_char_scalar(str, i, n, c, callback);
+}
 
-  char& front() { return str_[0]; }
+#endif
+
+template <typename Callback>
+void for_each_char(const char* str, size_t n, char c, Callback callback) {
+#ifdef STRING_SEARCH_X86
+  if (has_avx2()) {
+    for_each_char_avx2(str, n, c, callback);
+  } else {
+    for_each_char_sse2(str, n, c, callback);
+  }
+#else
+  for_each_char_scalar(str, 0, n, c, callback);
+#endif
+}
 
-  const char& back() const { return str_[len_-1]; }
+}  // namespace string_search
 
-  char& back() { return str_[len_-1]; }
+// wyhash (final version 4) over raw bytes. Inputs up to 16 bytes are read with
+// a few overlapping loads and no loop; longer ones run three independent
+// 64x64->128 multiply lanes over 48-byte blocks, which keeps the multipliers
+// busy the way SIMD lanes would.
+namespace string_hash {
 
-  String& operator+=(const String& other) {
-    increase_cap(len_ + other.len_);
-    std::copy(other.str_, other.str_ + other.len_, str_ + len_);
-    len_ += other.len_;
-    str_[len_] = '\0';
-    return *this;
+static constexpr uint64_t kSecret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+                                        0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+inline uint64_t read8(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+inline uint64_t read4(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+inline uint64_t read3(const uint8_t* p, size_t k) {
+  return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+inline void mum(uint64_t& a, uint64_t& b) {
+#ifdef __SIZEOF_INT128__
+  __uint128_t r = static_cast<__uint128_t>(a) * b;
+  a = static_cast<uint64_t>(r);
+  b = static_cast<uint64_t>(r >> 64);
+#else
+  uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32), c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+  a = lo;
+  b = hi;
+#endif
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b) {
+  mum(a, b);
+  return a ^ b;
+}
+
+inline uint64_t hash_bytes(const void* key, size_t len, uint64_t seed = 0) {
+  const uint8_t* p = static_cast<const uint8_t*>(key);
+  seed ^= mix(seed ^ kSecret[0], kSecret[1]);
+  uint64_t a;
+  uint64_t b;
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+      b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = read3(p, len);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = len;
+    if (i >= 48) {
+      uint64_t seed1 = seed;
+      uint64_t seed2 = seed;
+      do {
+        seed = mix(read8(p) ^ kSecret[1], read8(p + 8) ^ seed);
+        seed1 = mix(read8(p + 16) ^ kSecret[2], read8(p + 24) ^ seed1);
+        seed2 = mix(read8(p + 32) ^ kSecret[3], read8(p + 40) ^ seed2);
+        p += 48;
+        i -= 48;
+      } while (i >= 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (i > 16) {
+      seed = mix(read8(p) ^ kSecret[1], read8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = read8(p + i - 16);
+    b = read8(p + i - 8);
   }
+  a ^= kSecret[1];
+  b ^= seed;
+  mum(a, b);
+  return mix(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+}
 
-  String& operator+=(char c) {
-    push_back(c);
-    return *this;
+}  // namespace string_hash
+
+// UTF-8 validation and decoding. Validity follows Unicode table 3-7: no
+// overlong forms, no surrogates, nothing above U+10FFFF. The AVX2 validator
+// is the lookup algorithm of Keiser and Lemire: three nibble-indexed shuffles
+// classify every byte pair at once, so each 32-byte block costs a handful of
+// instructions regardless of content, and all-ASCII blocks skip even that.
+namespace utf8 {
+
+// Number of bytes in the sequence led by 'lead', or 0 for a byte that cannot
+// start one.
+inline size_t sequence_length(unsigned char lead) {
+  if (lead < 0x80) return 1;
+  if (lead < 0xC2) return 0;
+  if (lead < 0xE0) return 2;
+  if (lead < 0xF0) return 3;
+  if (lead < 0xF5) return 4;
+  return 0;
+}
+
+// Decodes the sequence at str[0, n) into 'cp' and returns its length, or 0 if
+// it is malformed or truncated.
+inline size_t decode(const unsigned char* str, size_t n, char32_t& cp) {
+  size_t len = sequence_length(str[0]);
+  if (len == 0 || len > n) return 0;
+  if (len == 1) {
+    cp = str[0];
+    return 1;
+  }
+  // The second byte range depends on the lead, the rest are plain 80..BF
+  unsigned char low = 0x80;
+  unsigned char high = 0xBF;
+  if (str[0] == 0xE0) low = 0xA0;
+  if (str[0] == 0xED) high = 0x9F;
+  if (str[0] == 0xF0) low = 0x90;
+  if (str[0] == 0xF4) high = 0x8F;
+  if (str[1] < low || str[1] > high) return 0;
+  cp = str[0] & (0x7F >> len);
+  for (size_t i = 1; i < len; ++i) {
+    if ((str[i] & 0xC0) != 0x80) return 0;
+    cp = (cp << 6) | (str[i] & 0x3F);
   }
+  return len;
+}
 
-  long long comp(const String& substr, size_t i) const {
-    if (str_[i] == substr.str_[0]) {
-      long long j = 1;
-      bool is_cmp = true;
-      while (j < static_cast<long long>(substr.len_)) {
-        if (str_[i + j] != substr.str_[j]) {
-          is_cmp = false;
-          break;
-        }
-        ++j;
+inline bool validate_scalar(const unsigned char* str, size_t n) {
+  const uint64_t kHighBits = 0x8080808080808080ull;
+  size_t i = 0;
+  while (i < n) {
+    if (i + 8 <= n) {
+      uint64_t word;
+      memcpy(&word, str + i, 8);
+      if ((word & kHighBits) == 0) {
+        i += 8;
+        continue;
       }
-      if (is_cmp) return i;
     }
-    return -1;
+    char32_t cp;
+    size_t len = decode(str + i, n - i, cp);
+    if (len == 0) return false;
+    i += len;
   }
+  return true;
+}
 
-  size_t find(const String& substr) const {
-    if (substr.len_ > len_) return len_;
-    for (size_t i = 0; i <= len_ - substr.len_; ++i) {
-      long long j = comp(substr, i);
-      if (j != -1) {
-        return j;
-      }
+// Continuation bytes are the ones in 80..BF, i.e. below -64 as signed char.
+inline size_t count_codepoints_scalar(const char* str, size_t from, size_t n) {
+  size_t count = 0;
+  for (size_t i = from; i < n; ++i) {
+    count += static_cast<signed char>(str[i]) >= -64;
+  }
+  return count;
+}
+
+#ifdef STRING_SEARCH_X86
+
+// Per-byte counters are bumped by subtracting the all-ones compare result and
+// folded into 64-bit sums with psadbw before they can wrap.
+inline size_t count_codepoints_sse2(const char* str, size_t n) {
+  const __m128i threshold = _mm_set1_epi8(-65);
+  __m128i total = _mm_setzero_si128();
+  size_t i = 0;
+  while (i + 16 <= n) {
+    __m128i counters = _mm_setzero_si128();
+    for (size_t round = 0; round < 255 && i + 16 <= n; ++round, i += 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+      counters = _mm_sub_epi8(counters, _mm_cmpgt_epi8(block, threshold));
     }
-    return len_;
+    total = _mm_add_epi64(total, _mm_sad_epu8(counters, _mm_setzero_si128()));
   }
+  uint64_t sums[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), total);
+  return sums[0] + sums[1] + count_codepoints_scalar(str, i, n);
+}
 
-  size_t rfind(const String& substr) const {
-    if (substr.len_ > len_) return len_;
-    for (long long i = len_ - substr.len_; i >= 0; --i) {
-      long long j = comp(substr, i);
-      if (j != -1) {
-        return j;
-      }
+// Error classes of a (previous byte, current byte) pair. A pair is invalid when
+// the classes of prev's high nibble, prev's low nibble and current's high
+// nibble share a bit.
+enum : uint8_t {
+  kTooShort = 1 << 0,      // lead followed by a lead or ASCII
+  kTooLong = 1 << 1,       // ASCII followed by a continuation
+  kOverlong3 = 1 << 2,     // E0 80..9F
+  kTooLarge = 1 << 3,      // F4 90..BF and F5..FF
+  kSurrogate = 1 << 4,     // ED A0..BF
+  kOverlong2 = 1 << 5,     // C0, C1
+  kTooLarge1000 = 1 << 6,  // F5..FF 80..8F
+  kOverlong4 = 1 << 6,     // F0 80..8F
+  kTwoConts = 1 << 7,      // continuation after continuation
+  kCarry = kTooShort | kTooLong | kTwoConts,
+};
+
+__attribute__((target("avx2")))
+inline __m256i lookup16(__m256i nibbles, __m256i table) {
+  return _mm256_shuffle_epi8(table, nibbles);
+}
+
+// Bytes of 'input' shifted right by N, with the tail of 'prev' shifted in.
+template <int N>
+__attribute__((target("avx2")))
+inline __m256i prev_bytes(__m256i input, __m256i prev) {
+  return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+}
+
+__attribute__((target("avx2")))
+inline __m256i check_block(__m256i input, __m256i prev_input) {
+  // The nibble tables, repeated for both 128-bit lanes. They are kept as
+  // bytes since most entries do not fit a signed char.
+  constexpr uint8_t big = kCarry | kTooLarge | kTooLarge1000;
+  constexpr uint8_t cont_80 = kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4;
+  constexpr uint8_t cont_90 = kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge;
+  constexpr uint8_t cont_a0 = kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge;
+  alignas(32) static const uint8_t byte_1_high_table[32] = {
+      kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+      kTwoConts, kTwoConts, kTwoConts, kTwoConts, kTooShort | kOverlong2, kTooShort,
+      kTooShort | kOverlong3 | kSurrogate, kTooShort | kTooLarge | kTooLarge1000 | kOverlong4,
+      kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+      kTwoConts, kTwoConts, kTwoConts, kTwoConts, kTooShort | kOverlong2, kTooShort,
+      kTooShort | kOverlong3 | kSurrogate, kTooShort | kTooLarge | kTooLarge1000 | kOverlong4};
+  alignas(32) static const uint8_t byte_1_low_table[32] = {
+      kCarry | kOverlong3 | kOverlong2 | kOverlong4, kCarry | kOverlong2, kCarry, kCarry,
+      kCarry | kTooLarge, big, big, big, big, big, big, big, big, big | kSurrogate, big, big,
+      kCarry | kOverlong3 | kOverlong2 | kOverlong4, kCarry | kOverlong2, kCarry, kCarry,
+      kCarry | kTooLarge, big, big, big, big, big, big, big, big, big | kSurrogate, big, big};
+  alignas(32) static const uint8_t byte_2_high_table[32] = {
+      kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+      cont_80, cont_90, cont_a0, cont_a0, kTooShort, kTooShort, kTooShort, kTooShort,
+      kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+      cont_80, cont_90, cont_a0, cont_a0, kTooShort, kTooShort, kTooShort, kTooShort};
+  const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+  const __m256i byte_1_high = _mm256_load_si256(reinterpret_cast<const __m256i*>(byte_1_high_table));
+  const __m256i byte_1_low = _mm256_load_si256(reinterpret_cast<const __m256i*>(byte_1_low_table));
+  const __m256i byte_2_high = _mm256_load_si256(reinterpret_cast<const __m256i*>(byte_2_high_table));
+
+  __m256i prev1 = prev_bytes<1>(input, prev_input);
+  __m256i special = _mm256_and_si256(
+      _mm256_and_si256(
+          lookup16(_mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble), byte_1_high),
+          lookup16(_mm256_and_si256(prev1, low_nibble), byte_1_low)),
+      lookup16(_mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble), byte_2_high));
+
+  // Third and fourth bytes of a sequence must be continuations: the table
+  // flagged them as kTwoConts, which is exactly right only for them
+  __m256i third = _mm256_subs_epu8(prev_bytes<2>(input, prev_input), _mm256_set1_epi8(0xE0 - 0x80));
+  __m256i fourth = _mm256_subs_epu8(prev_bytes<3>(input, prev_input), _mm256_set1_epi8(0xF0 - 0x80));
+  __m256i must_be_cont = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                          _mm256_set1_epi8(static_cast<char>(0x80)));
+  return _mm256_xor_si256(must_be_cont, special);
+}
+
+// Non-zero where the block ends inside a sequence that the next block has to
+// finish.
+__attribute__((target("avx2")))
+inline __m256i incomplete_tail(__m256i input) {
+  const __m256i max_value = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, static_cast<char>(0xF0 - 1),
+      static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+  return _mm256_subs_epu8(input, max_value);
+}
+
+// Folds one block into 'error'. All-ASCII blocks only need to check that the
+// previous block did not stop mid-sequence.
+__attribute__((target("avx2")))
+inline void validate_block(__m256i input, __m256i& prev_input, __m256i& prev_incomplete,
+                           __m256i& error) {
+  if (_mm256_movemask_epi8(input) == 0) {
+    error = _mm256_or_si256(error, prev_incomplete);
+  } else {
+    error = _mm256_or_si256(error, check_block(input, prev_input));
+    prev_incomplete = incomplete_tail(input);
+  }
+  prev_input = input;
+}
+
+__attribute__((target("avx2")))
+inline bool validate_avx2(const unsigned char* str, size_t n) {
+  __m256i error = _mm256_setzero_si256();
+  __m256i prev_input = _mm256_setzero_si256();
+  __m256i prev_incomplete = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+    validate_block(input, prev_input, prev_incomplete, error);
+  }
+  // The zero padding is ASCII, so a sequence cut off by the end is reported
+  // either by the padded block or by the all-zero one after it
+  alignas(32) unsigned char tail[32] = {};
+  memcpy(tail, str + i, n - i);
+  validate_block(_mm256_load_si256(reinterpret_cast<const __m256i*>(tail)), prev_input,
+                 prev_incomplete, error);
+  validate_block(_mm256_setzero_si256(), prev_input, prev_incomplete, error);
+  return _mm256_testz_si256(error, error);
+}
+
+#endif
+
+inline bool validate(const char* str, size_t n) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(str);
+#ifdef STRING_SEARCH_X86
+  if (string_search::has_avx2()) return validate_avx2(bytes, n);
+#endif
+  return validate_scalar(bytes, n);
+}
+
+// Counts bytes that are not continuations, which is the codepoint count of
+// valid UTF-8.
+inline size_t count_codepoints(const char* str, size_t n) {
+#ifdef STRING_SEARCH_X86
+  return count_codepoints_sse2(str, n);
+#else
+  return count_codepoints_scalar(str, 0, n);
+#endif
+}
+
+// Forward iterator over the codepoints of a byte range. A malformed or
+// truncated sequence decodes as U+FFFD and consumes one byte, so iterating
+// never leaves the range.
+class CodepointIterator {
+  const char* pos_;
+  const char* end_;
+
+  size_t step(char32_t& cp) const {
+    size_t len = decode(reinterpret_cast<const unsigned char*>(pos_), end_ - pos_, cp);
+    if (len == 0) {
+      cp = kReplacement;
+      len = 1;
     }
-    return len_;
+    return len;
   }
 
-  String substr(size_t start, size_t count) const {
-    if (start > len_) start = len_;
-    count = (start + count > len_) ? len_ - start : count;
-    String new_str(count, '\0');
-    std::copy(str_ + start, str_ + start + count, new_str.str_);
-    new_str.str_[count] = '\0';
-    new_str.len_ = count;
-    return new_str;
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = char32_t;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = char32_t;
+
+  static constexpr char32_t kReplacement = 0xFFFD;
+
+  CodepointIterator() : pos_(nullptr), end_(nullptr) {}
+
+  CodepointIterator(const char* pos, const char* end) : pos_(pos), end_(end) {}
+
+  char32_t operator*() const {
+    char32_t cp;
+    step(cp);
+    return cp;
   }
 
-  bool empty() const { return len_ == 0; }
+  // Byte offset of the current codepoint relative to 'base'.
+  size_t offset(const char* base) const { return pos_ - base; }
 
-  void clear() {
-    len_ = 0; 
-    str_[len_] = '\0';
+  CodepointIterator& operator++() {
+    char32_t cp;
+    pos_ += step(cp);
+    return *this;
   }
 
-  void shrink_to_fit() {
-    if (len_ < cap_) {
-      char* new_str = new char[len_ + 1];
-      std::copy(str_, str_ + len_, new_str);
-      new_str[len_] = '\0';
-      delete[] str_;
-      str_ = new_str;
-      cap_ = len_;
-    }
+  CodepointIterator operator++(int) {
+    CodepointIterator copy = *this;
+    ++*this;
+    return copy;
   }
 
-  const char* data() const { return str_; }
+  bool operator==(const CodepointIterator& other) const { return pos_ == other.pos_; }
+};
 
-  char* data() { return str_; }
+class CodepointRange {
+  const char* begin_;
+  const char* end_;
+
+ public:
+  CodepointRange(const char* str, size_t n) : begin_(str), end_(str + n) {}
+
+  CodepointIterator begin() const { return CodepointIterator(begin_, end_); }
+
+  CodepointIterator end() const { return CodepointIterator(end_, end_); }
 };
 
-bool operator==(const String& first, const String& second) {
-  return strcmp(first.data(), second.data()) == 0;
+}  // namespace utf8
+
+// ASCII case mapping and case-insensitive matching. Only A-Z and a-z fold;
+// every other byte, including UTF-8 sequences, compares as itself. The SSE2
+// kernels fold 16 bytes at a time with a signed range compare.
+namespace ascii {
+
+inline char lower(char c) { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; }
+
+inline char upper(char c) { return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c; }
+
+inline void to_lower_scalar(char* str, size_t from, size_t n) {
+  for (size_t i = from; i < n; ++i) str[i] = lower(str[i]);
 }
 
-bool operator!=(const String& first, const String& second) {
-  return !(first == second);
+inline void to_upper_scalar(char* str, size_t from, size_t n) {
+  for (size_t i = from; i < n; ++i) str[i] = upper(str[i]);
 }
 
-bool operator<(const String& first, const String& second) {
-  return strcmp(first.data(), second.data()) < 0;
+inline int compare_scalar(const char* first, const char* second, size_t from, size_t n) {
+  for (size_t i = from; i < n; ++i) {
+    unsigned char a = lower(first[i]);
+    unsigned char b = lower(second[i]);
+    if (a != b) return a < b ? -1 : 1;
+  }
+  return 0;
 }
 
-bool operator>(const String& first, const String& second) {
-  return second < first;
+#ifdef STRING_SEARCH_X86
+
+// Flips bit 0x20 of the bytes in [first, last], which must both be letters of
+// the same case.
+inline __m128i flip_case(__m128i block, char first, char last) {
+  __m128i in_range = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(first - 1)),
+                                   _mm_cmplt_epi8(block, _mm_set1_epi8(last + 1)));
+  return _mm_xor_si128(block, _mm_and_si128(in_range, _mm_set1_epi8(0x20)));
 }
 
-bool operator>=(const String& first, const String& second) {
-  return !(first < second);
+inline __m128i lower(__m128i block) { return flip_case(block, 'A', 'Z'); }
+
+inline void to_lower_sse2(char* str, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i* pos = reinterpret_cast<__m128i*>(str + i);
+    _mm_storeu_si128(pos, lower(_mm_loadu_si128(pos)));
+  }
+  to_lower_scalar(str, i, n);
 }
 
-bool operator<=(const String& first, const String& second) {
-  return second >= first;
+inline void to_upper_sse2(char* str, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i* pos = reinterpret_cast<__m128i*>(str + i);
+    _mm_storeu_si128(pos, flip_case(_mm_loadu_si128(pos), 'a', 'z'));
+  }
+  to_upper_scalar(str, i, n);
 }
 
-String operator+(const String& first, const String& second) {
-  String new_str(first);
-  new_str += second;
-  return new_str;
+inline int compare_sse2(const char* first, const char* second, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = lower(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i)));
+    __m128i b = lower(_mm_loadu_si128(reinterpret_cast<const __m128i*>(second + i)));
+    unsigned diff = _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) ^ 0xFFFF;
+    if (diff != 0) {
+      size_t pos = i + __builtin_ctz(diff);
+      return compare_scalar(first, second, pos, pos + 1);
+    }
+  }
+  return compare_scalar(first, second, i, n);
 }
 
-std::ostream& operator<<(std::ostream& os, const String& string) {
-  for (size_t i = 0; i < string.length(); ++i) {
-    os << string[i];
+// Same filter as string_search::find_sse2, run on folded blocks against the
+// folded first and last needle bytes.
+inline size_t find_sse2(const char* hay, size_t n, const char* needle, size_t m) {
+  const __m128i first = _mm_set1_epi8(ascii::lower(needle[0]));
+  const __m128i last = _mm_set1_epi8(ascii::lower(needle[m - 1]));
+  size_t i = 0;
+  for (; i + m + 15 <= n; i += 16) {
+    __m128i block_first = lower(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i)));
+    __m128i block_last = lower(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + m - 1)));
+    unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                    _mm_cmpeq_epi8(block_last, last)));
+    while (mask != 0) {
+      size_t pos = i + __builtin_ctz(mask);
+      if (compare_sse2(hay + pos, needle, m) == 0) return pos;
+      mask &= mask - 1;
+    }
   }
-  return os;
+  for (; i + m <= n; ++i) {
+    if (compare_scalar(hay + i, needle, 0, m) == 0) return i;
+  }
+  return n;
 }
 
-std::istream& operator>>(std::istream& is, String& string) {
-  string.clear();
-  char c;
-  while (is.get(c) && c == ' ') {}
-  if (c == '\n') return is;
-  if (is) {
-    do {
-      string.push_back(c);
-    } while (is.get(c) && c != ' ' && c != '\n');
+#endif
+
+inline void to_lower(char* str, size_t n) {
+#ifdef STRING_SEARCH_X86
+  to_lower_sse2(str, n);
+#else
+  to_lower_scalar(str, 0, n);
+#endif
+}
+
+inline void to_upper(char* str, size_t n) {
+#ifdef STRING_SEARCH_X86
+  to_upper_sse2(str, n);
+#else
+  to_upper_scalar(str, 0, n);
+#endif
+}
+
+// memcmp on folded bytes.
+inline int compare(const char* first, const char* second, size_t n) {
+#ifdef STRING_SEARCH_X86
+  return compare_sse2(first, second, n);
+#else
+  return compare_scalar(first, second, 0, n);
+#endif
+}
+
+// Offset of the first case-insensitive match, or n; an empty needle gives n
+// like string_search::find.
+inline size_t find(const char* hay, size_t n, const char* needle, size_t m) {
+  if (m == 0 || m > n) return n;
+#ifdef STRING_SEARCH_X86
+  return find_sse2(hay, n, needle, m);
+#else
+  for (size_t i = 0; i + m <= n; ++i) {
+    if (compare_scalar(hay + i, needle, 0, m) == 0) return i;
   }
-  return is;
+  return n;
+#endif
+}
+
+// Hash of the folded bytes, equal to string_hash::hash_bytes of the lowercase
+// copy for keys up to kChunk bytes. Longer keys are folded and hashed chunk by
+// chunk, each chunk seeding the next.
+inline uint64_t hash(const char* str, size_t n) {
+  static constexpr size_t kChunk = 256;
+  char folded[kChunk];
+  uint64_t seed = 0;
+  size_t i = 0;
+  do {
+    size_t count = std::min(kChunk, n - i);
+    memcpy(folded, str + i, count);
+    to_lower(folded, count);
+    seed = string_hash::hash_bytes(folded, count, seed);
+    i += count;
+  } while (i < n);
+  return seed;
+}
+
+}  // namespace ascii
+
+// Thread pool and the parallel find_all built on it.
+namespace string_parallel {
+
+// Fixed set of worker threads draining a FIFO of tasks. parallel_for is the
+// intended entry point: the calling thread takes part in the work too, so a
+// pool with no workers degrades to a plain loop.
+class ThreadPool {
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+
+  void work() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+        if (tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+ public:
+  explicit ThreadPool(size_t threads) {
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+      workers_.emplace_back([this] { work(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Finishes queued tasks, then joins.
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) worker.join();
+  }
+
+  // Pool shared by the string algorithms, one worker per hardware thread
+  // besides the caller's. Started on first use.
+  static ThreadPool& shared() {
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+  }
+
+  size_t size() const { return workers_.size(); }
+
+  void submit(std::function<void()> task) {
+    {
+      std::lock_guard lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    wake_.notify_one();
+  }
+
+  // Runs body(i) for every i in [0, count) and returns once all calls have
+  // finished. Indices are claimed dynamically, so uneven chunks balance out.
+  // The first exception thrown by body is rethrown here.
+  template <typename Body>
+  void parallel_for(size_t count, Body body) {
+    // Helpers that start after the loop is over find no index to claim and
+    // touch only this shared state, never the caller's stack
+    struct Job {
+      std::atomic<size_t> next{0};
+      size_t done = 0;
+      std::exception_ptr error;
+      std::mutex mutex;
+      std::condition_variable finished;
+    };
+    auto job = std::make_shared<Job>();
+    auto run = [job, count, &body] {
+      size_t ran = 0;
+      std::exception_ptr error;
+      for (size_t i; (i = job->next.fetch_add(1, std::memory_order_relaxed)) < count; ++ran) {
+        try {
+          body(i);
+        } catch (...) {
+          if (!error) error = std::current_exception();
+        }
+      }
+      if (ran == 0) return;
+      std::lock_guard lock(job->mutex);
+      if (error && !job->error) job->error = error;
+      job->done += ran;
+      if (job->done == count) job->finished.notify_all();
+    };
+    size_t helpers = std::min(size(), count == 0 ? 0 : count - 1);
+    for (size_t i = 0; i < helpers; ++i) submit(run);
+    run();
+    std::unique_lock lock(job->mutex);
+    job->finished.wait(lock, [&] { return job->done == count; });
+    if (job->error) std::rethrow_exception(job->error);
+  }
+};
+
+// Appends the start of every occurrence in hay[from, to + m - 1) that begins
+// before 'to', overlapping ones included.
+inline void find_all_range(const char* hay, size_t from, size_t to, const char* needle, size_t m,
+                           std::vector<size_t>& out) {
+  const char* base = hay + from;
+  size_t n = to - from + m - 1;
+  if (m >= string_search::kHorspoolMinNeedle) {
+    // One shift table for the whole range rather than one per match
+    size_t shift[256];
+    string_search::horspool_shifts(needle, m, shift);
+    for (size_t pos = 0; (pos = string_search::find_horspool(base, n, pos, needle, m, shift)) != n;
+         ++pos) {
+      out.push_back(from + pos);
+    }
+    return;
+  }
+  for (size_t pos = 0;; ++pos) {
+    size_t found = string_search::find(base + pos, n - pos, needle, m);
+    if (found == n - pos) return;
+    pos += found;
+    out.push_back(from + pos);
+  }
+}
+
+// Ascending offsets of every occurrence of needle in hay, overlapping ones
+// included. Large inputs are cut into chunks of match start positions; each
+// chunk also reads the m - 1 bytes past its end, so matches straddling a cut
+// are found exactly once, by the chunk they start in.
+inline std::vector<size_t> find_all(const char* hay, size_t n, const char* needle, size_t m,
+                                    ThreadPool& pool = ThreadPool::shared()) {
+  static constexpr size_t kMinChunk = 1 << 18;
+  std::vector<size_t> matches;
+  if (m == 0 || m > n) return matches;
+  size_t starts = n - m + 1;
+  size_t chunks = std::min(starts / kMinChunk, 4 * (pool.size() + 1));
+  if (chunks <= 1) {
+    find_all_range(hay, 0, starts, needle, m, matches);
+    return matches;
+  }
+  size_t chunk_len = (starts + chunks - 1) / chunks;
+  std::vector<std::vector<size_t>> found(chunks);
+  pool.parallel_for(chunks, [&](size_t i) {
+    size_t from = i * chunk_len;
+    find_all_range(hay, from, std::min(from + chunk_len, starts), needle, m, found[i]);
+  });
+  size_t total = 0;
+  for (const std::vector<size_t>& part : found) total += part.size();
+  matches.reserve(total);
+  for (const std::vector<size_t>& part : found) {
+    matches.insert(matches.end(), part.begin(), part.end());
+  }
+  return matches;
 }
+
+}  // namespace string_parallel
+
+// Non-owning view of a char range. It does not keep the viewed String alive
+// and is not null-terminated, so it must not outlive or outgrow its source.
+class StringView {
+  const char* str_;
+  size_t len_;
+
+ public:
+  StringView() : str_(""), len_(0) {}
+
+  StringView(const char* str, size_t len) : str_(str), len_(len) {}
+
+  StringView(const char* str) : str_(str), len_(strlen(str)) {}
+
+  const char& operator[](size_t ind) const { return str_[ind]; }
+
+  size_t length() const { return len_; }
+
+  size_t size() const { return length(); }
+
+  bool empty() const { return len_ == 0; }
+
+  const char& front() const { return str_[0]; }
+
+  const char& back() const { return str_[len_ - 1]; }
+
+  const char* data() const { return str_; }
+
+  const char* begin() const { return str_; }
+
+  const char* end() const { return str_ + len_; }
+
+  void remove_prefix(size_t count) {
+    count = std::min(count, len_);
+    str_ += count;
+    len_ -= count;
+  }
+
+  void remove_suffix(size_t count) { len_ -= std::min(count, len_); }
+
+  StringView substr(size_t start, size_t count) const {
+    if (start > len_) start = len_;
+    count = (start + count > len_) ? len_ - start : count;
+    return StringView(str_ + start, count);
+  }
+
+  size_t find(StringView substr) const {
+    return string_search::find(str_, len_, substr.str_, substr.len_);
+  }
+
+  size_t rfind(StringView substr) const {
+    return string_search::rfind(str_, len_, substr.str_, substr.len_);
+  }
+
+  size_t find(char c) const {
+    const void* pos = memchr(str_, c, len_);
+    return pos ? static_cast<const char*>(pos) - str_ : len_;
+  }
+
+  // Every occurrence, overlapping ones included, scanned in parallel for
+  // large views.
+  std::vector<size_t> find_all(StringView substr) const {
+    return string_parallel::find_all(str_, len_, substr.str_, substr.len_);
+  }
+
+  bool starts_with(StringView prefix) const {
+    return prefix.len_ <= len_ && memcmp(str_, prefix.str_, prefix.len_) == 0;
+  }
+
+  bool ends_with(StringView suffix) const {
+    return suffix.len_ <= len_ && memcmp(str_ + len_ - suffix.len_, suffix.str_, suffix.len_) == 0;
+  }
+
+  static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+  StringView ltrim() const {
+    size_t start = 0;
+    while (start < len_ && is_space(str_[start])) ++start;
+    return StringView(str_ + start, len_ - start);
+  }
+
+  StringView rtrim() const {
+    size_t count = len_;
+    while (count > 0 && is_space(str_[count - 1])) --count;
+    return StringView(str_, count);
+  }
+
+  StringView trim() const { return ltrim().rtrim(); }
+
+  // Calls callback on every field between delimiters, empty fields included,
+  // without allocating.
+  template <typename Callback>
+  void split(char delim, Callback callback) const {
+    size_t start = 0;
+    string_search::for_each_char(str_, len_, delim, [&](size_t pos) {
+      callback(StringView(str_ + start, pos - start));
+      start = pos + 1;
+    });
+    callback(StringView(str_ + start, len_ - start));
+  }
+
+  std::vector<StringView> split(char delim) const {
+    std::vector<StringView> fields;
+    split(delim, [&fields](StringView field) { fields.push_back(field); });
+    return fields;
+  }
+
+  bool is_valid_utf8() const { return utf8::validate(str_, len_); }
+
+  // Number of codepoints, assuming the bytes are valid UTF-8.
+  size_t codepoint_count() const { return utf8::count_codepoints(str_, len_); }
+
+  utf8::CodepointRange codepoints() const { return utf8::CodepointRange(str_, len_); }
+
+  size_t find_ignore_case(StringView substr) const {
+    return ascii::find(str_, len_, substr.str_, substr.len_);
+  }
+
+  bool equals_ignore_case(StringView other) const {
+    return len_ == other.len_ && ascii::compare(str_, other.str_, len_) == 0;
+  }
+
+  // Ordering of the ASCII-lowercased contents. Weak, since strings differing
+  // only in case are equivalent but not equal.
+  std::weak_ordering compare_ignore_case(StringView other) const {
+    int cmp = ascii::compare(str_, other.str_, std::min(len_, other.len_));
+    if (cmp != 0) return cmp <=> 0;
+    return len_ <=> other.len_;
+  }
+};
+
+inline bool operator==(StringView first, StringView second) {
+  return first.length() == second.length() &&
+         memcmp(first.data(), second.data(), first.length()) == 0;
+}
+
+// Bytes compare as unsigned char, a proper prefix orders first. The remaining
+// relational operators are synthesized from this one.
+inline std::strong_ordering operator<=>(StringView first, StringView second) {
+  int cmp = memcmp(first.data(), second.data(), std::min(first.length(), second.length()));
+  if (cmp != 0) return cmp <=> 0;
+  return first.length() <=> second.length();
+}
+
+inline std::ostream& operator<<(std::ostream& os, StringView view) {
+  os.write(view.data(), view.length());
+  return os;
+}
+
+template <>
+struct std::hash<StringView> {
+  size_t operator()(StringView view) const {
+    return string_hash::hash_bytes(view.data(), view.length());
+  }
+};
+
+// Heap activity of BasicString on the current thread. Counting is compiled in
+// only with -DSTRING_INSTRUMENTATION; otherwise every counter stays zero and
+// the hooks vanish. Shared-mode blocks count like ordinary buffers.
+struct StringStats {
+  size_t allocations = 0;
+  size_t deallocations = 0;
+  size_t bytes_allocated = 0;
+  // Buffer moves on growth (increase_cap) and on detaching a shared buffer.
+  size_t reallocations = 0;
+  // Bytes moved from an old buffer into a new one by reallocations, share()
+  // and shrink_to_fit().
+  size_t bytes_copied = 0;
+  // shrink_to_fit() calls that released memory.
+  size_t shrinks = 0;
+
+  // Activity between two snapshots.
+  friend StringStats operator-(const StringStats& last, const StringStats& first) {
+    return {last.allocations - first.allocations,
+            last.deallocations - first.deallocations,
+            last.bytes_allocated - first.bytes_allocated,
+            last.reallocations - first.reallocations,
+            last.bytes_copied - first.bytes_copied,
+            last.shrinks - first.shrinks};
+  }
+};
+
+namespace string_stats {
+
+#ifdef STRING_INSTRUMENTATION
+inline constexpr bool kEnabled = true;
+#else
+inline constexpr bool kEnabled = false;
+#endif
+
+inline StringStats& current() {
+  thread_local StringStats stats;
+  return stats;
+}
+
+inline void add(size_t StringStats::*counter, size_t value = 1) {
+  if constexpr (kEnabled) current().*counter += value;
+}
+
+// Counters of the calling thread so far.
+inline StringStats snapshot() { return current(); }
+
+inline void reset() { current() = StringStats(); }
+
+}  // namespace string_stats
+
+template <typename CharT, typename Alloc = std::allocator<CharT>>
+class BasicString {
+  using traits = std::char_traits<CharT>;
+  using AllocTraits = std::allocator_traits<Alloc>;
+
+  // Header in front of the chars of a shared-mode heap buffer.
+  struct SharedHeader {
+    std::atomic<size_t> refs;
+  };
+
+  using HeaderAlloc = typename AllocTraits::template rebind_alloc<SharedHeader>;
+  using HeaderAllocTraits = std::allocator_traits<HeaderAlloc>;
+
+  // Strings of up to kInlineCap chars live in buf_, longer ones on the heap.
+  // The object is inline exactly when cap_ == kInlineCap.
+  static constexpr size_t kInlineCap = 16 / sizeof(CharT) - 1;
+  // Set in cap_ while the heap buffer is in shared mode (see share()).
+  static constexpr size_t kSharedBit = ~(~size_t(0) >> 1);
+
+  size_t cap_;
+  size_t len_;
+  union {
+    CharT* str_;
+    CharT buf_[kInlineCap + 1];
+  };
+  [[no_unique_address]] Alloc alloc_;
+
+  bool is_inline() const { return cap_ == kInlineCap; }
+
+  bool is_shared() const { return cap_ & kSharedBit; }
+
+  size_t cap() const { return cap_ & ~kSharedBit; }
+
+  CharT* raw() { return is_inline() ? buf_ : str_; }
+
+  const CharT* raw() const { return is_inline() ? buf_ : str_; }
+
+  CharT* allocate(size_t cap) {
+    string_stats::add(&StringStats::allocations);
+    string_stats::add(&StringStats::bytes_allocated, (cap + 1) * sizeof(CharT));
+    return AllocTraits::allocate(alloc_, cap + 1);
+  }
+
+  void deallocate(CharT* str, size_t cap) {
+    string_stats::add(&StringStats::deallocations);
+    AllocTraits::deallocate(alloc_, str, cap + 1);
+  }
+
+  // A shared buffer of the given capacity takes this many SharedHeader-sized
+  // units, the header included, so that the header stays aligned.
+  static size_t shared_units(size_t cap) {
+    return 1 + ((cap + 1) * sizeof(CharT) + sizeof(SharedHeader) - 1) / sizeof(SharedHeader);
+  }
+
+  SharedHeader* header() const {
+    return reinterpret_cast<SharedHeader*>(str_) - 1;
+  }
+
+  void free_heap() {
+    if (is_inline()) return;
+    if (!is_shared()) {
+      deallocate(str_, cap_);
+    } else if (header()->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      string_stats::add(&StringStats::deallocations);
+      HeaderAlloc header_alloc(alloc_);
+      SharedHeader* block = header();
+      block->~SharedHeader();
+      HeaderAllocTraits::deallocate(header_alloc, block, shared_units(cap()));
+    }
+  }
+
+  bool can_share(const BasicString& other) const {
+    return other.is_shared() && alloc_ == other.alloc_;
+  }
+
+  void adopt_shared(const BasicString& other) {
+    other.header()->refs.fetch_add(1, std::memory_order_relaxed);
+    str_ = other.str_;
+    cap_ = other.cap_;
+    len_ = other.len_;
+  }
+
+  void init(size_t len, size_t cap) {
+    len_ = len;
+    if (cap <= kInlineCap) {
+      cap_ = kInlineCap;
+    } else {
+      str_ = allocate(cap);
+      cap_ = cap;
+    }
+  }
+
+  void release() {
+    free_heap();
+    cap_ = kInlineCap;
+    len_ = 0;
+    buf_[0] = CharT();
+  }
+
+  // Takes over other's buffer and leaves other as an empty inline string.
+  // The allocators must be equal or already propagated.
+  void steal(BasicString& other) {
+    cap_ = other.cap_;
+    len_ = other.len_;
+    if (other.is_inline()) {
+      traits::copy(buf_, other.buf_, len_ + 1);
+    } else {
+      str_ = other.str_;
+      other.cap_ = kInlineCap;
+      other.len_ = 0;
+      other.buf_[0] = CharT();
+    }
+  }
+
+  // Replaces the contents, reusing the current buffer when it is big enough.
+  void assign_chars(const CharT* str, size_t count) {
+    if (is_shared()) {
+      release();
+    }
+    if (count > cap_) {
+      CharT* new_str = allocate(count);
+      free_heap();
+      str_ = new_str;
+      cap_ = count;
+    }
+    len_ = count;
+    traits::copy(raw(), str, count);
+    raw()[len_] = CharT();
+  }
+
+  // Inserts other in front of the current contents, capacity must suffice.
+  void prepend(const BasicString& other) {
+    CharT* str = raw();
+    traits::move(str + other.len_, str, len_ + 1);
+    traits::copy(str, other.raw(), other.len_);
+    len_ += other.len_;
+  }
+
+  // Moves the contents into a new private heap buffer of the given capacity.
+  void reallocate(size_t cap) {
+    string_stats::add(&StringStats::reallocations);
+    string_stats::add(&StringStats::bytes_copied, (len_ + 1) * sizeof(CharT));
+    CharT* new_str = allocate(cap);
+    traits::copy(new_str, raw(), len_ + 1);
+    free_heap();
+    str_ = new_str;
+    cap_ = cap;
+  }
+
+  // Gives the string a private buffer before it is written to. The buffer is
+  // copied even when this is the last reference, so no char& handed out
+  // afterwards can ever alias a buffer that later copies share.
+  void unshare() {
+    if (is_shared()) reallocate(cap());
+  }
+
+  // Detaching a shared buffer and growing it take a single reallocation.
+  void increase_cap(size_t new_cap) {
+    if (new_cap <= cap()) {
+      unshare();
+      return;
+    }
+    reallocate(std::max(new_cap, cap() * 2));
+  }
+
+  static Alloc copy_allocator(const BasicString& other) {
+    return AllocTraits::select_on_container_copy_construction(other.alloc_);
+  }
+
+
+public:
+  using value_type = CharT;
+  using allocator_type = Alloc;
+
+  explicit BasicString(const Alloc& alloc) : alloc_(alloc) {
+    init(0, 0);
+    buf_[0] = CharT();
+  }
+
+  BasicString() : BasicString(Alloc()) {}
+
+  BasicString(const CharT c, const Alloc& alloc = Alloc()) : alloc_(alloc) {
+    init(1, 1);
+    buf_[0] = c;
+    buf_[1] = CharT();
+  }
+
+  BasicString(size_t len, CharT c, const Alloc& alloc = Alloc()) : alloc_(alloc) {
+    init(len, len);
+    traits::assign(raw(), len_, c);
+    raw()[len_] = CharT();
+  }
+
+  BasicString(const CharT* string, const Alloc& alloc = Alloc()) : alloc_(alloc) {
+    size_t len = traits::length(string);
+    init(len, len);
+    traits::copy(raw(), string, len_ + 1);
+  }
+
+  BasicString(const BasicString& other, const Alloc& alloc) : alloc_(alloc) {
+    if (can_share(other)) {
+      adopt_shared(other);
+      return;
+    }
+    init(other.len_, other.cap());
+    traits::copy(raw(), other.raw(), len_ + 1);
+  }
+
+  BasicString(const BasicString& other) : BasicString(other, copy_allocator(other)) {}
+
+  explicit BasicString(StringView view, const Alloc& alloc = Alloc())
+    requires std::is_same_v<CharT, char>
+    : alloc_(alloc)
+  {
+    init(view.length(), view.length());
+    traits::copy(raw(), view.data(), len_);
+    raw()[len_] = CharT();
+  }
+
+  BasicString(BasicString&& other) noexcept : alloc_(std::move(other.alloc_)) {
+    steal(other);
+  }
+
+  ~BasicString() {
+    free_heap();
+  }
+
+  BasicString& operator=(const BasicString& other) {
+    if (this != &other) {
+      if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+        if (alloc_ != other.alloc_) {
+          release();
+        }
+        alloc_ = other.alloc_;
+      }
+      if (can_share(other)) {
+        release();
+        adopt_shared(other);
+      } else {
+        assign_chars(other.raw(), other.len_);
+      }
+    }
+    return *this;
+  }
+
+  BasicString& operator=(BasicString&& other) noexcept(
+    AllocTraits::propagate_on_container_move_assignment::value ||
+    AllocTraits::is_always_equal::value
+  ) {
+    if (this != &other) {
+      if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+        release();
+        alloc_ = std::move(other.alloc_);
+        steal(other);
+      } else {
+        if (alloc_ == other.alloc_) {
+          release();
+          steal(other);
+        } else {
+          assign_chars(other.raw(), other.len_);
+        }
+      }
+    }
+    return *this;
+  }
+
+  Alloc get_allocator() const { return alloc_; }
+
+  CharT& operator[](size_t ind) {
+    unshare();
+    return raw()[ind];
+  }
+
+  const CharT& operator[](size_t ind) const { return raw()[ind]; }
+
+  size_t length() const { return len_; }
+
+  size_t size() const { return length(); }
+
+  size_t capacity() const { return cap(); }
+
+  // Makes room for new_cap chars without the geometric growth of push_back.
+  void reserve(size_t new_cap) {
+    if (new_cap > cap()) {
+      reallocate(new_cap);
+    } else {
+      unshare();
+    }
+  }
+
+  void resize(size_t count, CharT c = CharT()) {
+    if (count > len_) {
+      append(count - len_, c);
+      return;
+    }
+    unshare();
+    len_ = count;
+    // An inline string never holds more than kInlineCap chars; spelling that
+    // out keeps GCC from taking a heap string's terminator for a store past
+    // buf_
+    if (count <= kInlineCap && is_inline()) {
+      buf_[count] = CharT();
+    } else {
+      str_[count] = CharT();
+    }
+  }
+
+  // Switches the heap buffer to the shared mode: copies of this string, and
+  // copies of those copies, then reference one buffer under an atomic count
+  // instead of duplicating it, until a copy is modified. Inline strings are
+  // left as they are, since copying them is already cheap. Buffers are only
+  // shared between strings whose allocators compare equal.
+  void share() {
+    if (is_inline() || is_shared()) return;
+    HeaderAlloc header_alloc(alloc_);
+    string_stats::add(&StringStats::allocations);
+    string_stats::add(&StringStats::bytes_allocated, shared_units(cap_) * sizeof(SharedHeader));
+    string_stats::add(&StringStats::bytes_copied, (len_ + 1) * sizeof(CharT));
+    SharedHeader* block = HeaderAllocTraits::allocate(header_alloc, shared_units(cap_));
+    new (block) SharedHeader{1};
+    CharT* new_str = reinterpret_cast<CharT*>(block + 1);
+    traits::copy(new_str, str_, len_ + 1);
+    deallocate(str_, cap_);
+    str_ = new_str;
+    cap_ |= kSharedBit;
+  }
+
+  // Number of strings referencing this buffer, 1 unless it is shared.
+  size_t use_count() const {
+    return is_shared() ? header()->refs.load(std::memory_order_relaxed) : 1;
+  }
+
+  void push_back(CharT c) {
+    increase_cap(len_ + 1);
+    raw()[len_] = c;
+    ++len_;
+    raw()[len_] = CharT();
+  }
+
+  void pop_back() {
+    if (len_ > 0) {
+      unshare();
+      --len_;
+      raw()[len_] = CharT();
+    }
+  }
+
+  const CharT& front() const { return raw()[0]; }
+
+  CharT& front() { return data()[0]; }
+
+  const CharT& back() const { return raw()[len_-1]; }
+
+  CharT& back() { return data()[len_-1]; }
+
+  BasicString& append(size_t count, CharT c) {
+    increase_cap(len_ + count);
+    traits::assign(raw() + len_, count, c);
+    len_ += count;
+    raw()[len_] = CharT();
+    return *this;
+  }
+
+  BasicString& append(const CharT* str) { return append(str, traits::length(str)); }
+
+  BasicString& append(const CharT* str, size_t count) {
+    // str may point into this string's buffer, which detaching or growing
+    // can free; it is located before the buffer moves.
+    std::less_equal<const CharT*> le;
+    if (le(raw(), str) && le(str, raw() + len_)) {
+      size_t offset = str - raw();
+      increase_cap(len_ + count);
+      str = raw() + offset;
+    } else {
+      increase_cap(len_ + count);
+    }
+    traits::copy(raw() + len_, str, count);
+    len_ += count;
+    raw()[len_] = CharT();
+    return *this;
+  }
+
+  BasicString& operator+=(const BasicString& other) {
+    increase_cap(len_ + other.len_);
+    traits::copy(raw() + len_, other.raw(), other.len_);
+    len_ += other.len_;
+    raw()[len_] = CharT();
+    return *this;
+  }
+
+  BasicString& operator+=(BasicString&& other) {
+    if (len_ == 0 && other.cap() > cap()) {
+      return *this = std::move(other);
+    }
+    return *this += other;
+  }
+
+  BasicString& operator+=(CharT c) {
+    push_back(c);
+    return *this;
+  }
+
+  BasicString& operator+=(const CharT* str) { return append(str); }
+
+  // Formats value with std::to_chars into a local buffer and appends it, so a
+  // short string stays inline. Only long fixed-point floats, which do not fit
+  // that buffer, are formatted straight into the grown capacity. Extra
+  // arguments (base, chars_format, precision) are passed through.
+  template <typename T, typename... Format>
+  BasicString& append_number(T value, Format... format)
+    requires std::is_same_v<CharT, char> && std::is_arithmetic_v<T>
+  {
+    char digits[32];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value, format...);
+    if (result.ec == std::errc()) {
+      return append(digits, result.ptr - digits);
+    }
+    size_t room = 2 * sizeof(digits);
+    while (true) {
+      increase_cap(len_ + room);
+      result = std::to_chars(raw() + len_, raw() + cap(), value, format...);
+      if (result.ec == std::errc()) {
+        len_ = result.ptr - raw();
+        raw()[len_] = CharT();
+        return *this;
+      }
+      room *= 2;
+    }
+  }
+
+  long long comp(const BasicString& substr, size_t i) const {
+    if (raw()[i] == substr.raw()[0]) {
+      long long j = 1;
+      bool is_cmp = true;
+      while (j < static_cast<long long>(substr.len_)) {
+        if (raw()[i + j] != substr.raw()[j]) {
+          is_cmp = false;
+          break;
+        }
+        ++j;
+      }
+      if (is_cmp) return i;
+    }
+    return -1;
+  }
+
+  size_t find(const BasicString& substr) const {
+    if constexpr (std::is_same_v<CharT, char>) {
+      return string_search::find(raw(), len_, substr.raw(), substr.len_);
+    } else {
+      if (substr.len_ == 0) return len_;
+      return std::search(raw(), raw() + len_, substr.raw(), substr.raw() + substr.len_) - raw();
+    }
+  }
+
+  size_t rfind(const BasicString& substr) const {
+    if constexpr (std::is_same_v<CharT, char>) {
+      return string_search::rfind(raw(), len_, substr.raw(), substr.len_);
+    } else {
+      if (substr.len_ == 0) return len_;
+      const CharT* pos = std::find_end(raw(), raw() + len_, substr.raw(), substr.raw() + substr.len_);
+      return pos - raw();
+    }
+  }
+
+  BasicString substr(size_t start, size_t count) const {
+    if (start > len_) start = len_;
+    count = (start + count > len_) ? len_ - start : count;
+    BasicString new_str(copy_allocator(*this));
+    new_str.assign_chars(raw() + start, count);
+    return new_str;
+  }
+
+  StringView view(size_t start, size_t count) const requires std::is_same_v<CharT, char> {
+    return StringView(raw(), len_).substr(start, count);
+  }
+
+  operator StringView() const requires std::is_same_v<CharT, char> {
+    return StringView(raw(), len_);
+  }
+
+  bool is_valid_utf8() const requires std::is_same_v<CharT, char> {
+    return utf8::validate(raw(), len_);
+  }
+
+  size_t codepoint_count() const requires std::is_same_v<CharT, char> {
+    return utf8::count_codepoints(raw(), len_);
+  }
+
+  utf8::CodepointRange codepoints() const requires std::is_same_v<CharT, char> {
+    return utf8::CodepointRange(raw(), len_);
+  }
+
+  // In-place ASCII case mapping; bytes outside A-Z/a-z are left alone.
+  BasicString& to_lower() requires std::is_same_v<CharT, char> {
+    unshare();
+    ascii::to_lower(raw(), len_);
+    return *this;
+  }
+
+  BasicString& to_upper() requires std::is_same_v<CharT, char> {
+    unshare();
+    ascii::to_upper(raw(), len_);
+    return *this;
+  }
+
+  std::vector<size_t> find_all(StringView substr) const requires std::is_same_v<CharT, char> {
+    return StringView(*this).find_all(substr);
+  }
+
+  size_t find_ignore_case(StringView substr) const requires std::is_same_v<CharT, char> {
+    return StringView(*this).find_ignore_case(substr);
+  }
+
+  bool equals_ignore_case(StringView other) const requires std::is_same_v<CharT, char> {
+    return StringView(*this).equals_ignore_case(other);
+  }
+
+  std::weak_ordering compare_ignore_case(StringView other) const
+    requires std::is_same_v<CharT, char>
+  {
+    return StringView(*this).compare_ignore_case(other);
+  }
+
+  bool empty() const { return len_ == 0; }
+
+  void clear() {
+    if (is_shared()) {
+      release();
+      return;
+    }
+    len_ = 0;
+    raw()[len_] = CharT();
+  }
+
+  void shrink_to_fit() {
+    if (is_inline() || is_shared() || len_ == cap_) return;
+    string_stats::add(&StringStats::shrinks);
+    string_stats::add(&StringStats::bytes_copied, (len_ + 1) * sizeof(CharT));
+    CharT* old_str = str_;
+    size_t old_cap = cap_;
+    if (len_ <= kInlineCap) {
+      traits::copy(buf_, old_str, len_ + 1);
+      cap_ = kInlineCap;
+    } else {
+      CharT* new_str = allocate(len_);
+      traits::copy(new_str, old_str, len_ + 1);
+      str_ = new_str;
+      cap_ = len_;
+    }
+    deallocate(old_str, old_cap);
+  }
+
+  const CharT* data() const { return raw(); }
+
+  CharT* data() {
+    unshare();
+    return raw();
+  }
+
+  friend bool operator==(const BasicString& first, const BasicString& second) {
+    return first.len_ == second.len_ &&
+           traits::compare(first.raw(), second.raw(), first.len_) == 0;
+  }
+
+  // Chars compare through char_traits (unsigned for char), a proper prefix
+  // orders first. The remaining relational operators are synthesized.
+  friend std::strong_ordering operator<=>(const BasicString& first, const BasicString& second) {
+    int cmp = traits::compare(first.raw(), second.raw(), std::min(first.len_, second.len_));
+    if (cmp != 0) return cmp <=> 0;
+    return first.len_ <=> second.len_;
+  }
+
+  friend BasicString operator+(const BasicString& first, const BasicString& second) {
+    BasicString new_str(copy_allocator(first));
+    new_str.increase_cap(first.len_ + second.len_);
+    new_str += first;
+    new_str += second;
+    return new_str;
+  }
+
+  friend BasicString operator+(BasicString&& first, const BasicString& second) {
+    first += second;
+    return std::move(first);
+  }
+
+  friend BasicString operator+(const BasicString& first, BasicString&& second) {
+    if (second.is_shared() || second.cap_ < first.len_ + second.len_) {
+      return first + second;
+    }
+    second.prepend(first);
+    return std::move(second);
+  }
+
+  friend BasicString operator+(BasicString&& first, BasicString&& second) {
+    return std::move(first) + second;
+  }
+};
+
+using String = BasicString<char>;
+
+// Appends each argument to out: chars and strings as they are, bool as
+// true/false, other numbers through append_number. No temporaries are built.
+template <typename Alloc, typename... Args>
+BasicString<char, Alloc>& format_to(BasicString<char, Alloc>& out, const Args&... args) {
+  auto append_one = [&out](const auto& value) {
+    using T = std::decay_t<decltype(value)>;
+    if constexpr (std::is_same_v<T, char>) {
+      out.push_back(value);
+    } else if constexpr (std::is_same_v<T, bool>) {
+      out.append(value ? "true" : "false");
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      out.append_number(value);
+    } else {
+      StringView view(value);
+      out.append(view.data(), view.length());
+    }
+  };
+  (append_one(args), ...);
+  return out;
+}
+
+// Hashes the same bytes as std::hash<StringView>, so a String and a view of
+// it land in the same bucket.
+template <typename CharT, typename Alloc>
+struct std::hash<BasicString<CharT, Alloc>> {
+  size_t operator()(const BasicString<CharT, Alloc>& string) const {
+    return string_hash::hash_bytes(string.data(), string.length() * sizeof(CharT));
+  }
+};
+
+// Hash and equality for case-insensitive keys, e.g.
+// UnorderedMap<String, V, CaseInsensitiveHash, CaseInsensitiveEqual>.
+struct CaseInsensitiveHash {
+  size_t operator()(StringView string) const { return ascii::hash(string.data(), string.length()); }
+};
+
+struct CaseInsensitiveEqual {
+  bool operator()(StringView first, StringView second) const {
+    return first.equals_ignore_case(second);
+  }
+};
+
+// Immutable String that hashes itself once on construction. Meant for map
+// keys that are looked up many times: std::hash returns the stored value and
+// equality rejects most mismatches on the hash alone.
+class HashedString {
+  String str_;
+  size_t hash_;
+
+ public:
+  HashedString() : hash_(std::hash<String>()(str_)) {}
+
+  HashedString(String string) : str_(std::move(string)), hash_(std::hash<String>()(str_)) {}
+
+  HashedString(const char* string) : HashedString(String(string)) {}
+
+  const String& str() const { return str_; }
+
+  const char* data() const { return str_.data(); }
+
+  size_t length() const { return str_.length(); }
+
+  size_t size() const { return length(); }
+
+  bool empty() const { return str_.empty(); }
+
+  const char& operator[](size_t ind) const { return str_[ind]; }
+
+  size_t hash() const { return hash_; }
+
+  operator StringView() const { return str_; }
+
+  friend bool operator==(const HashedString& first, const HashedString& second) {
+    return first.hash_ == second.hash_ && first.str_ == second.str_;
+  }
+};
+
+template <>
+struct std::hash<HashedString> {
+  size_t operator()(const HashedString& string) const { return string.hash(); }
+};
+
+template <typename CharT, typename Alloc>
+std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& os,
+                                      const BasicString<CharT, Alloc>& string) {
+  for (size_t i = 0; i < string.length(); ++i) {
+    os << string[i];
+  }
+  return os;
+}
+
+// Exposes the get area of a streambuf, so extraction can take whole buffered
+// chunks instead of going through the stream once per character.
+template <typename CharT>
+struct StreamBufferAccess : std::basic_streambuf<CharT> {
+  using Buffer = std::basic_streambuf<CharT>;
+
+  static const CharT* chunk_begin(Buffer* buf) {
+    return (buf->*&StreamBufferAccess::gptr)();
+  }
+
+  static const CharT* chunk_end(Buffer* buf) {
+    return (buf->*&StreamBufferAccess::egptr)();
+  }
+
+  static void consume(Buffer* buf, size_t count) {
+    (buf->*&StreamBufferAccess::gbump)(static_cast<int>(count));
+  }
+};
+
+// Appends input to string up to the first char located by find_stop, which is
+// consumed but not stored. Returns false if the input ended first. Buffered
+// streams (files, string streams, std::cin after sync_with_stdio(false)) are
+// copied a chunk at a time, unbuffered ones fall back to single chars.
+template <typename CharT, typename Alloc, typename FindStop>
+bool read_until(std::basic_streambuf<CharT>* buf, BasicString<CharT, Alloc>& string,
+                FindStop find_stop) {
+  using traits = std::char_traits<CharT>;
+  using Access = StreamBufferAccess<CharT>;
+  while (true) {
+    const CharT* begin = Access::chunk_begin(buf);
+    const CharT* end = Access::chunk_end(buf);
+    if (begin == end) {
+      auto c = buf->sbumpc();
+      if (traits::eq_int_type(c, traits::eof())) return false;
+      CharT ch = traits::to_char_type(c);
+      if (find_stop(&ch, &ch + 1) != &ch + 1) return true;
+      string.push_back(ch);
+      continue;
+    }
+    const CharT* stop = find_stop(begin, end);
+    string.append(begin, stop - begin);
+    if (stop != end) {
+      Access::consume(buf, stop - begin + 1);
+      return true;
+    }
+    Access::consume(buf, end - begin);
+  }
+}
+
+// Skips leading spaces and reads a word ending at a space or a newline. A
+// newline met before the word is consumed and yields an empty string.
+template <typename CharT, typename Alloc>
+std::basic_istream<CharT>& operator>>(std::basic_istream<CharT>& is,
+                                      BasicString<CharT, Alloc>& string) {
+  using traits = std::char_traits<CharT>;
+  const CharT space = is.widen(' ');
+  const CharT newline = is.widen('\n');
+  string.clear();
+  typename std::basic_istream<CharT>::sentry sentry(is, true);
+  if (!sentry) return is;
+  std::basic_streambuf<CharT>* buf = is.rdbuf();
+  auto c = buf->sgetc();
+  while (traits::eq_int_type(c, traits::to_int_type(space))) {
+    c = buf->snextc();
+  }
+  if (traits::eq_int_type(c, traits::eof())) {
+    is.setstate(std::ios::eofbit | std::ios::failbit);
+    return is;
+  }
+  if (traits::eq_int_type(c, traits::to_int_type(newline))) {
+    buf->sbumpc();
+    return is;
+  }
+  auto find_stop = [space, newline](const CharT* begin, const CharT* end) {
+    while (begin != end && *begin != space && *begin != newline) ++begin;
+    return begin;
+  };
+  if (!read_until(buf, string, find_stop)) {
+    is.setstate(std::ios::eofbit);
+  }
+  return is;
+}
+
+template <typename CharT, typename Alloc>
+std::basic_istream<CharT>& getline(std::basic_istream<CharT>& is,
+                                   BasicString<CharT, Alloc>& string, CharT delim) {
+  using traits = std::char_traits<CharT>;
+  string.clear();
+  typename std::basic_istream<CharT>::sentry sentry(is, true);
+  if (!sentry) return is;
+  auto find_stop = [delim](const CharT* begin, const CharT* end) {
+    const CharT* pos = traits::find(begin, end - begin, delim);
+    return pos ? pos : end;
+  };
+  if (!read_until(is.rdbuf(), string, find_stop)) {
+    is.setstate(string.empty() ? std::ios::eofbit | std::ios::failbit : std::ios::eofbit);
+  }
+  return is;
+}
+
+template <typename CharT, typename Alloc>
+std::basic_istream<CharT>& getline(std::basic_istream<CharT>& is,
+                                   BasicString<CharT, Alloc>& string) {
+  return getline(is, string, is.widen('\n'));
+}
+
+// Aho-Corasick automaton over a fixed set of patterns. Bytes are folded into
+// equivalence classes (one per byte that occurs in some pattern, plus one for
+// everything else), so the complete DFA fits in a dense states x classes table
+// and scanning costs one table lookup per input byte.
+class PatternSet {
+ public:
+  struct Match {
+    size_t pattern;
+    size_t pos;
+  };
+
+ private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  // Bytes that occur in no pattern share class 0, so up to 257 classes.
+  uint16_t class_of_[256] = {};
+  size_t classes_ = 1;
+  std::vector<uint32_t> next_;
+  // Pattern ending in the state, chained through same_end_ for duplicates.
+  std::vector<uint32_t> output_;
+  // Nearest state on the suffix chain that has an output.
+  std::vector<uint32_t> dict_link_;
+  std::vector<uint32_t> same_end_;
+  std::vector<size_t> lengths_;
+  // Whether reaching the state completes at least one pattern.
+  std::vector<uint8_t> hit_;
+
+  uint32_t add_state() {
+    next_.resize(next_.size() + classes_, 0);
+    output_.push_back(kNone);
+    dict_link_.push_back(kNone);
+    return output_.size() - 1;
+  }
+
+  size_t cell(uint32_t state, char c) const {
+    return state * classes_ + class_of_[static_cast<unsigned char>(c)];
+  }
+
+  void insert(const String& pattern, uint32_t id) {
+    uint32_t state = 0;
+    for (size_t i = 0; i < pattern.length(); ++i) {
+      if (next_[cell(state, pattern[i])] == 0) {
+        uint32_t created = add_state();
+        next_[cell(state, pattern[i])] = created;
+      }
+      state = next_[cell(state, pattern[i])];
+    }
+    same_end_[id] = output_[state];
+    output_[state] = id;
+  }
+
+  void build_links() {
+    std::vector<uint32_t> fail(output_.size(), 0);
+    std::vector<uint32_t> queue;
+    for (size_t c = 0; c < classes_; ++c) {
+      if (next_[c] != 0) queue.push_back(next_[c]);
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+      uint32_t state = queue[head];
+      uint32_t link = fail[state];
+      dict_link_[state] = output_[link] != kNone ? link : dict_link_[link];
+      for (size_t c = 0; c < classes_; ++c) {
+        uint32_t& to = next_[state * classes_ + c];
+        if (to != 0) {
+          fail[to] = next_[link * classes_ + c];
+          queue.push_back(to);
+        } else {
+          to = next_[link * classes_ + c];
+        }
+      }
+    }
+  }
+
+  template <typename Callback>
+  void report(uint32_t state, size_t end, Callback& callback) const {
+    if (output_[state] == kNone) state = dict_link_[state];
+    while (state != kNone) {
+      for (uint32_t id = output_[state]; id != kNone; id = same_end_[id]) {
+        callback(Match{id, end + 1 - lengths_[id]});
+      }
+      state = dict_link_[state];
+    }
+  }
+
+ public:
+  // Incremental scanner for input that arrives in pieces. Match positions are
+  // counted from the first byte fed to the stream.
+  class Stream {
+    const PatternSet& set_;
+    uint32_t state_ = 0;
+    size_t offset_ = 0;
+
+   public:
+    explicit Stream(const PatternSet& set) : set_(set) {}
+
+    template <typename Callback>
+    void feed(const char* data, size_t n, Callback callback) {
+      const uint32_t* next = set_.next_.data();
+      const uint8_t* hit = set_.hit_.data();
+      uint32_t state = state_;
+      for (size_t i = 0; i < n; ++i) {
+        state = next[set_.cell(state, data[i])];
+        if (hit[state]) set_.report(state, offset_ + i, callback);
+      }
+      state_ = state;
+      offset_ += n;
+    }
+
+    void reset() {
+      state_ = 0;
+      offset_ = 0;
+    }
+  };
+
+  // Empty patterns are accepted but never reported. Pattern ids are indices
+  // into the constructor argument.
+  explicit PatternSet(const std::vector<String>& patterns)
+    : same_end_(patterns.size(), kNone)
+    , lengths_(patterns.size())
+  {
+    for (const String& pattern : patterns) {
+      for (size_t i = 0; i < pattern.length(); ++i) {
+        uint16_t& cls = class_of_[static_cast<unsigned char>(pattern[i])];
+        if (cls == 0) cls = classes_++;
+      }
+    }
+    add_state();
+    for (size_t id = 0; id < patterns.size(); ++id) {
+      lengths_[id] = patterns[id].length();
+      if (!patterns[id].empty()) insert(patterns[id], id);
+    }
+    build_links();
+    hit_.resize(output_.size());
+    for (size_t state = 0; state < output_.size(); ++state) {
+      hit_[state] = output_[state] != kNone || dict_link_[state] != kNone;
+    }
+  }
+
+  size_t size() const { return lengths_.size(); }
+
+  template <typename Callback>
+  void scan(const String& text, Callback callback) const {
+    Stream(*this).feed(text.data(), text.length(), callback);
+  }
+
+  template <typename Callback>
+  void scan(std::istream& is, Callback callback) const {
+    Stream stream(*this);
+    char chunk[1 << 16];
+    std::streamsize got;
+    while ((got = is.rdbuf()->sgetn(chunk, sizeof(chunk))) > 0) {
+      stream.feed(chunk, got, callback);
+    }
+    is.setstate(std::ios::eofbit);
+  }
+
+  // Matches are ordered by end position, longer patterns first on ties.
+  std::vector<Match> find_all(const String& text) const {
+    std::vector<Match> matches;
+    scan(text, [&matches](Match match) { matches.push_back(match); });
+    return matches;
+  }
+
+  std::vector<Match> find_all(std::istream& is) const {
+    std::vector<Match> matches;
+    scan(is, [&matches](Match match) { matches.push_back(match); });
+    return matches;
+  }
+
+  bool contains_any(const String& text) const {
+    const char* str = text.data();
+    uint32_t state = 0;
+    for (size_t i = 0; i < text.length(); ++i) {
+      state = next_[cell(state, str[i])];
+      if (hit_[state]) return true;
+    }
+    return false;
+  }
+};
+
+// Immutable-node rope: an AVL-balanced tree whose leaves are slices of shared
+// String buffers. Concatenation, insert, erase and substr rebuild only the
+// O(log n) nodes along the cut, and copies of a rope share all of its nodes.
+// data() flattens the rope into a single buffer on demand and keeps it as the
+// new root, so repeated reads of a settled rope stay contiguous. It is not
+// const for that reason: const members never write to the rope, so ropes
+// shared between threads can be read concurrently.
+class RopeString {
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+
+  struct Node {
+    NodePtr left;
+    NodePtr right;
+    // Leaves view buf[offset, offset + length).
+    std::shared_ptr<const String> buf;
+    size_t offset = 0;
+    size_t length = 0;
+    int height = 0;
+
+    bool is_leaf() const { return !left; }
+
+    const char* chars() const { return buf->data() + offset; }
+  };
+
+  static const size_t kLeafMax = 512;
+
+  NodePtr root_;
+
+  static int height(const NodePtr& node) { return node ? node->height : -1; }
+
+  static size_t length(const NodePtr& node) { return node ? node->length : 0; }
+
+  static NodePtr make_leaf(std::shared_ptr<const String> buf, size_t offset, size_t count) {
+    if (count == 0) return nullptr;
+    auto node = std::make_shared<Node>();
+    node->buf = std::move(buf);
+    node->offset = offset;
+    node->length = count;
+    return node;
+  }
+
+  static NodePtr make_leaf(StringView view) {
+    return make_leaf(std::make_shared<String>(view), 0, view.length());
+  }
+
+  static NodePtr make_node(NodePtr left, NodePtr right) {
+    auto node = std::make_shared<Node>();
+    node->length = left->length + right->length;
+    node->height = std::max(left->height, right->height) + 1;
+    node->left = std::move(left);
+    node->right = std::move(right);
+    return node;
+  }
+
+  // Builds a node from subtrees whose heights differ by at most two,
+  // rotating once or twice to restore the AVL invariant.
+  static NodePtr balance(const NodePtr& left, const NodePtr& right) {
+    if (height(left) > height(right) + 1) {
+      if (height(left->left) >= height(left->right)) {
+        return make_node(left->left, make_node(left->right, right));
+      }
+      const NodePtr& mid = left->right;
+      return make_node(make_node(left->left, mid->left), make_node(mid->right, right));
+    }
+    if (height(right) > height(left) + 1) {
+      if (height(right->right) >= height(right->left)) {
+        return make_node(make_node(left, right->left), right->right);
+      }
+      const NodePtr& mid = right->left;
+      return make_node(make_node(left, mid->left), make_node(mid->right, right->right));
+    }
+    return make_node(left, right);
+  }
+
+  static NodePtr join(const NodePtr& left, const NodePtr& right) {
+    if (!left) return right;
+    if (!right) return left;
+    if (left->is_leaf() && right->is_leaf() && left->length + right->length <= kLeafMax) {
+      auto buf = std::make_shared<String>(StringView(left->chars(), left->length));
+      buf->append(right->chars(), right->length);
+      return make_leaf(std::move(buf), 0, left->length + right->length);
+    }
+    if (height(left) > height(right) + 1) {
+      return balance(left->left, join(left->right, right));
+    }
+    if (height(right) > height(left) + 1) {
+      return balance(join(left, right->left), right->right);
+    }
+    return make_node(left, right);
+  }
+
+  // Splits into the first pos chars and the rest.
+  static std::pair<NodePtr, NodePtr> split(const NodePtr& node, size_t pos) {
+    if (!node) return {nullptr, nullptr};
+    if (pos == 0) return {nullptr, node};
+    if (pos >= node->length) return {node, nullptr};
+    if (node->is_leaf()) {
+      return {make_leaf(node->buf, node->offset, pos),
+              make_leaf(node->buf, node->offset + pos, node->length - pos)};
+    }
+    if (pos <= node->left->length) {
+      auto [first, second] = split(node->left, pos);
+      return {first, join(second, node->right)};
+    }
+    auto [first, second] = split(node->right, pos - node->left->length);
+    return {join(node->left, first), second};
+  }
+
+  // Returns the leaf holding pos together with the position of its first char.
+  static std::pair<const Node*, size_t> locate(const Node* node, size_t pos) {
+    size_t start = 0;
+    while (!node->is_leaf()) {
+      if (pos - start < node->left->length) {
+        node = node->left.get();
+      } else {
+        start += node->left->length;
+        node = node->right.get();
+      }
+    }
+    return {node, start};
+  }
+
+  template <typename Callback>
+  static void visit(const NodePtr& node, Callback& callback) {
+    if (!node) return;
+    if (node->is_leaf()) {
+      callback(StringView(node->chars(), node->length));
+      return;
+    }
+    visit(node->left, callback);
+    visit(node->right, callback);
+  }
+
+  explicit RopeString(NodePtr root) : root_(std::move(root)) {}
+
+  // Appends c to the last leaf in place when that leaf ends its buffer, has
+  // room, and nothing but this rope references it or the nodes above it.
+  // Copies and iterators hold references, so they never see the change.
+  bool append_in_place(char c) {
+    if (!root_ || root_.use_count() != 1) return false;
+    const Node* leaf = root_.get();
+    while (!leaf->is_leaf()) {
+      if (leaf->right.use_count() != 1) return false;
+      leaf = leaf->right.get();
+    }
+    if (leaf->length >= kLeafMax || leaf->buf.use_count() != 1 ||
+        leaf->offset + leaf->length != leaf->buf->length()) {
+      return false;
+    }
+    // Nodes and leaf buffers are all created non-const
+    const_cast<String&>(*leaf->buf).push_back(c);
+    for (const Node* node = root_.get(); node; node = node->right.get()) {
+      ++const_cast<Node*>(node)->length;
+    }
+    return true;
+  }
+
+  // Like visit, in either direction, until callback returns true. Returns
+  // whether it did.
+  template <bool kReverse, typename Callback>
+  static bool visit_until(const NodePtr& node, Callback& callback) {
+    if (!node) return false;
+    if (node->is_leaf()) return callback(StringView(node->chars(), node->length));
+    const NodePtr& first = kReverse ? node->right : node->left;
+    const NodePtr& second = kReverse ? node->left : node->right;
+    return visit_until<kReverse>(first, callback) || visit_until<kReverse>(second, callback);
+  }
+
+ public:
+  // Forward iterator over the chars. It keeps the nodes it walks alive, so it
+  // stays valid across data(), but it does not see later modifications.
+  class const_iterator {
+    NodePtr root_;
+    size_t pos_ = 0;
+    const char* chunk_ = nullptr;
+    size_t chunk_begin_ = 0;
+    size_t chunk_end_ = 0;
+
+    void load() {
+      if (pos_ >= length(root_)) return;
+      auto [leaf, start] = locate(root_.get(), pos_);
+      chunk_ = leaf->chars();
+      chunk_begin_ = start;
+      chunk_end_ = start + leaf->length;
+    }
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const char*;
+    using reference = const char&;
+
+    const_iterator() = default;
+
+    const_iterator(NodePtr root, size_t pos) : root_(std::move(root)), pos_(pos) { load(); }
+
+    reference operator*() const { return chunk_[pos_ - chunk_begin_]; }
+
+    const_iterator& operator++() {
+      if (++pos_ == chunk_end_) load();
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    bool operator==(const const_iterator& other) const { return pos_ == other.pos_; }
+
+    size_t position() const { return pos_; }
+  };
+
+  RopeString() = default;
+
+  RopeString(const char* string) : root_(make_leaf(StringView(string))) {}
+
+  RopeString(const String& string) : root_(make_leaf(string)) {}
+
+  explicit RopeString(StringView view) : root_(make_leaf(view)) {}
+
+  size_t length() const { return RopeString::length(root_); }
+
+  size_t size() const { return length(); }
+
+  bool empty() const { return !root_; }
+
+  char operator[](size_t ind) const {
+    auto [leaf, start] = locate(root_.get(), ind);
+    return leaf->chars()[ind - start];
+  }
+
+  const_iterator begin() const { return const_iterator(root_, 0); }
+
+  const_iterator end() const { return const_iterator(nullptr, length()); }
+
+  // Calls callback on each contiguous piece in order.
+  template <typename Callback>
+  void for_each_chunk(Callback callback) const {
+    visit(root_, callback);
+  }
+
+  RopeString& operator+=(const RopeString& other) {
+    root_ = join(root_, other.root_);
+    return *this;
+  }
+
+  RopeString& operator+=(char c) {
+    push_back(c);
+    return *this;
+  }
+
+  // Amortized O(1): chars go into the last leaf's buffer until it is full or
+  // shared, and only then is a new leaf joined on.
+  void push_back(char c) {
+    if (!append_in_place(c)) *this += RopeString(StringView(&c, 1));
+  }
+
+  void insert(size_t pos, const RopeString& other) {
+    auto [first, second] = split(root_, pos);
+    root_ = join(join(first, other.root_), second);
+  }
+
+  void erase(size_t pos, size_t count) {
+    auto [first, rest] = split(root_, pos);
+    root_ = join(first, split(rest, count).second);
+  }
+
+  RopeString substr(size_t start, size_t count) const {
+    return RopeString(split(split(root_, start).second, count).first);
+  }
+
+  void clear() { root_ = nullptr; }
+
+  // Null-terminated contiguous contents. Flattens the rope the first time
+  // after a modification; the pointer stays valid until the next modification.
+  const char* data() {
+    if (!root_) return "";
+    if (!root_->is_leaf() || root_->offset + root_->length != root_->buf->length()) {
+      auto buf = std::make_shared<String>(length(), '\0');
+      char* out = buf->data();
+      for_each_chunk([&out](StringView chunk) {
+        out = std::copy(chunk.begin(), chunk.end(), out);
+      });
+      root_ = make_leaf(std::move(buf), 0, length());
+    }
+    return root_->chars();
+  }
+
+  operator StringView() { return StringView(data(), length()); }
+
+  String str() const {
+    String result;
+    result.reserve(length());
+    for_each_chunk([&result](StringView chunk) { result.append(chunk.data(), chunk.length()); });
+    return result;
+  }
+
+  // Searches leaf by leaf without flattening. Matches that cross a leaf
+  // boundary are looked for in the m - 1 chars on either side of it, so the
+  // only copying is of those windows.
+  size_t find(StringView substr) const {
+    size_t m = substr.length();
+    size_t result = length();
+    if (m == 0 || m > result) return result;
+    String carry;   // the last m - 1 chars before the current leaf
+    String joined;  // carry and the first m - 1 chars of the leaf
+    size_t start = 0;
+    auto search = [&](StringView chunk) {
+      if (!carry.empty()) {
+        joined = carry;
+        joined.append(chunk.data(), std::min(chunk.length(), m - 1));
+        size_t pos = StringView(joined).find(substr);
+        if (pos != joined.length()) {
+          result = start - carry.length() + pos;
+          return true;
+        }
+      }
+      size_t pos = chunk.find(substr);
+      if (pos != chunk.length()) {
+        result = start + pos;
+        return true;
+      }
+      size_t tail = std::min(chunk.length(), m - 1);
+      size_t kept = std::min(carry.length(), m - 1 - tail);
+      String next(StringView(carry).substr(carry.length() - kept, kept));
+      next.append(chunk.data() + chunk.length() - tail, tail);
+      carry = std::move(next);
+      start += chunk.length();
+      return false;
+    };
+    visit_until<false>(root_, search);
+    return result;
+  }
+
+  // Mirror image of find: the window holds the first m - 1 chars after the
+  // current leaf.
+  size_t rfind(StringView substr) const {
+    size_t m = substr.length();
+    size_t result = length();
+    if (m == 0 || m > result) return result;
+    String carry;
+    String joined;
+    size_t end = result;
+    auto search = [&](StringView chunk) {
+      size_t start = end - chunk.length();
+      if (!carry.empty()) {
+        size_t head = std::min(chunk.length(), m - 1);
+        joined = String(chunk.substr(chunk.length() - head, head));
+        joined += carry;
+        size_t pos = StringView(joined).rfind(substr);
+        if (pos != joined.length()) {
+          result = end - head + pos;
+          return true;
+        }
+      }
+      size_t pos = chunk.rfind(substr);
+      if (pos != chunk.length()) {
+        result = start + pos;
+        return true;
+      }
+      String next(chunk.substr(0, std::min(chunk.length(), m - 1)));
+      next.append(carry.data(), std::min(carry.length(), m - 1 - next.length()));
+      carry = std::move(next);
+      end = start;
+      return false;
+    };
+    visit_until<true>(root_, search);
+    return result;
+  }
+
+  friend RopeString operator+(const RopeString& first, const RopeString& second) {
+    return RopeString(join(first.root_, second.root_));
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const RopeString& rope) {
+  rope.for_each_chunk([&os](StringView chunk) { os << chunk; });
+  return os;
+}
+
+class StringPool;
+
+// Handle to a string deduplicated by a StringPool. Handles from the same pool
+// are equal exactly when their contents are, so equality is a pointer compare
+// and the hash is computed once at interning time. A handle is valid while its
+// pool is alive; handles from different pools never compare equal, except for
+// the empty string.
+class InternedString {
+  friend class StringPool;
+
+  struct Entry {
+    size_t hash;
+    size_t len;
+
+    const char* chars() const { return reinterpret_cast<const char*>(this + 1); }
+  };
+
+  const Entry* entry_ = nullptr;
+
+  explicit InternedString(const Entry* entry) : entry_(entry) {}
+
+ public:
+  InternedString() = default;
+
+  const char* data() const { return entry_ ? entry_->chars() : ""; }
+
+  size_t length() const { return entry_ ? entry_->len : 0; }
+
+  size_t size() const { return length(); }
+
+  bool empty() const { return !entry_; }
+
+  size_t hash() const { return entry_ ? entry_->hash : 0; }
+
+  operator StringView() const { return StringView(data(), length()); }
+
+  String str() const { return String(StringView(*this)); }
+
+  friend bool operator==(InternedString first, InternedString second) {
+    return first.entry_ == second.entry_;
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& os, InternedString string) {
+  return os << StringView(string);
+}
+
+template <>
+struct std::hash<InternedString> {
+  size_t operator()(InternedString string) const { return string.hash(); }
+};
+
+// Deduplicating store for strings. Contents are copied once into large arena
+// blocks and indexed by an open-addressing table; all memory is released
+// together when the pool is destroyed. Not thread-safe.
+class StringPool {
+  using Entry = InternedString::Entry;
+
+  static constexpr size_t kBlockSize = 64 * 1024;
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char* block_pos_ = nullptr;
+  size_t block_left_ = 0;
+  // Power-of-two sized, kept at most half full.
+  std::vector<const Entry*> table_;
+  size_t size_ = 0;
+  size_t bytes_ = 0;
+
+  char* allocate(size_t bytes) {
+    bytes = (bytes + alignof(Entry) - 1) / alignof(Entry) * alignof(Entry);
+    if (bytes > block_left_) {
+      size_t block_size = std::max(bytes, kBlockSize);
+      blocks_.emplace_back(new char[block_size]);
+      block_pos_ = blocks_.back().get();
+      block_left_ = block_size;
+    }
+    char* result = block_pos_;
+    block_pos_ += bytes;
+    block_left_ -= bytes;
+    bytes_ += bytes;
+    return result;
+  }
+
+  void grow() {
+    std::vector<const Entry*> table(std::max<size_t>(table_.size() * 2, 64), nullptr);
+    size_t mask = table.size() - 1;
+    for (const Entry* entry : table_) {
+      if (!entry) continue;
+      size_t i = entry->hash & mask;
+      while (table[i]) i = (i + 1) & mask;
+      table[i] = entry;
+    }
+    table_ = std::move(table);
+  }
+
+ public:
+  StringPool() = default;
+  StringPool(const StringPool&) = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  InternedString intern(StringView string) {
+    if (string.empty()) return InternedString();
+    if ((size_ + 1) * 2 > table_.size()) grow();
+    size_t hash = string_hash::hash_bytes(string.data(), string.length());
+    size_t mask = table_.size() - 1;
+    size_t i = hash & mask;
+    for (; table_[i]; i = (i + 1) & mask) {
+      const Entry* entry = table_[i];
+      if (entry->hash == hash && StringView(entry->chars(), entry->len) == string) {
+        return InternedString(entry);
+      }
+    }
+    char* memory = allocate(sizeof(Entry) + string.length() + 1);
+    Entry* entry = new (memory) Entry{hash, string.length()};
+    char* chars = memory + sizeof(Entry);
+    std::copy(string.begin(), string.end(), chars);
+    chars[string.length()] = '\0';
+    table_[i] = entry;
+    ++size_;
+    return InternedString(entry);
+  }
+
+  // Looks the string up without adding it; returns an empty handle if absent.
+  InternedString find(StringView string) const {
+    if (string.empty() || table_.empty()) return InternedString();
+    size_t hash = string_hash::hash_bytes(string.data(), string.length());
+    size_t mask = table_.size() - 1;
+    for (size_t i = hash & mask; table_[i]; i = (i + 1) & mask) {
+      const Entry* entry = table_[i];
+      if (entry->hash == hash && StringView(entry->chars(), entry->len) == string) {
+        return InternedString(entry);
+      }
+    }
+    return InternedString();
+  }
+
+  // Number of distinct non-empty strings.
+  size_t size() const { return size_; }
+
+  // Arena bytes taken by entries, headers included.
+  size_t memory_usage() const { return bytes_; }
+};
+
+#ifdef STRING_HAS_MMAP
+
+// Read-only contents of a file mapped into memory. Pages are read in lazily by
+// the kernel, so opening a multi-gigabyte file costs one syscall and nothing
+// is copied. The read API mirrors String; substr returns a StringView into
+// the mapping, which stays valid while the MappedString is alive. Failing to
+// open or map the file throws std::system_error.
+class MappedString {
+  const char* str_ = "";
+  size_t len_ = 0;
+
+  void unmap() {
+    if (len_ != 0) munmap(const_cast<char*>(str_), len_);
+    str_ = "";
+    len_ = 0;
+  }
+
+  [[noreturn]] static void fail(const char* what, const char* path) {
+    throw std::system_error(errno, std::generic_category(), std::string(what) + " " + path);
+  }
+
+ public:
+  MappedString() = default;
+
+  explicit MappedString(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) fail("open", path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      int error = errno;
+      close(fd);
+      errno = error;
+      fail("fstat", path);
+    }
+    // mmap rejects empty ranges, an empty file just stays unmapped
+    if (st.st_size > 0) {
+      void* memory = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (memory == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        fail("mmap", path);
+      }
+      str_ = static_cast<const char*>(memory);
+      len_ = st.st_size;
+    }
+    close(fd);
+  }
+
+  MappedString(const MappedString&) = delete;
+
+  MappedString& operator=(const MappedString&) = delete;
+
+  MappedString(MappedString&& other) noexcept : str_(other.str_), len_(other.len_) {
+    other.str_ = "";
+    other.len_ = 0;
+  }
+
+  MappedString& operator=(MappedString&& other) noexcept {
+    if (this != &other) {
+      unmap();
+      std::swap(str_, other.str_);
+      std::swap(len_, other.len_);
+    }
+    return *this;
+  }
+
+  ~MappedString() { unmap(); }
+
+  // Tells the kernel the whole file will be read front to back, which enables
+  // aggressive read-ahead for single-pass scans.
+  void advise_sequential() const {
+    if (len_ != 0) madvise(const_cast<char*>(str_), len_, MADV_SEQUENTIAL);
+  }
+
+  const char& operator[](size_t ind) const { return str_[ind]; }
+
+  size_t length() const { return len_; }
+
+  size_t size() const { return length(); }
+
+  bool empty() const { return len_ == 0; }
+
+  const char& front() const { return str_[0]; }
+
+  const char& back() const { return str_[len_ - 1]; }
+
+  // Not null-terminated.
+  const char* data() const { return str_; }
+
+  const char* begin() const { return str_; }
+
+  const char* end() const { return str_ + len_; }
+
+  operator StringView() const { return StringView(str_, len_); }
+
+  StringView substr(size_t start, size_t count) const {
+    return StringView(*this).substr(start, count);
+  }
+
+  size_t find(StringView substr) const { return StringView(*this).find(substr); }
+
+  size_t rfind(StringView substr) const { return StringView(*this).rfind(substr); }
+
+  size_t find(char c) const { return StringView(*this).find(c); }
+
+  std::vector<size_t> find_all(StringView substr) const { return StringView(*this).find_all(substr); }
+
+  String str() const { return String(StringView(*this)); }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const MappedString& string) {
+  return os << StringView(string);
+}
+
+#endif
@@ -0,0 +1,461 @@
+#include "string.h"
+
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+// Builds 'lines' lines of 'words_per_line' words, 'word_len' chars each
+std::string MakeInput(size_t lines, size_t words_per_line, size_t word_len) {
+    std::string input;
+    for (size_t i = 0; i < lines; ++i) {
+        for (size_t j = 0; j < words_per_line; ++j) {
+            if (j != 0) {
+                input += ' ';
+            }
+            input.append(word_len, static_cast<char>('a' + (i + j) % 26));
+        }
+        input += '\n';
+    }
+    return input;
+}
+
+// Keeps the compiler from dropping loops whose results are otherwise unused
+volatile size_t benchmark_sink;
+
+template <typename Clock = std::chrono::high_resolution_clock>
+class Timer {
+    typename Clock::time_point start_ = Clock::now();
+
+public:
+    double Ms() const {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+    }
+};
+
+template <typename Str>
+double ExtractWordsBenchmark(const std::string& input, size_t& chars) {
+    std::istringstream in(input);
+    Str word;
+    chars = 0;
+    Timer<> timer;
+    while (in >> word) {
+        chars += word.length();
+    }
+    return timer.Ms();
+}
+
+template <typename Str>
+double GetlineBenchmark(const std::string& input, size_t& chars) {
+    std::istringstream in(input);
+    Str line;
+    chars = 0;
+    Timer<> timer;
+    while (getline(in, line)) {
+        chars += line.length();
+    }
+    return timer.Ms();
+}
+
+void ReportRow(const char* name, double mine, double baseline) {
+    std::cerr << "  " << name << ": String " << mine << " ms, std::string " << baseline
+              << " ms (x" << baseline / mine << ")" << std::endl;
+}
+
+// Size classes for the core operations: inline, one cache line, several pages
+struct SizeClass {
+    const char* name;
+    size_t len;
+    size_t repeats;
+};
+const SizeClass kSizeClasses[] = {
+    {"8 B", 8, 4'000'000},
+    {"64 B", 64, 1'000'000},
+    {"4 KiB", 4096, 20'000},
+};
+
+// Both string types are driven through the same code, so the timings differ
+// only in the class under test.
+template <typename Str>
+double ConstructBenchmark(const std::string& source, size_t repeats) {
+    size_t chars = 0;
+    Timer<> timer;
+    for (size_t i = 0; i < repeats; ++i) {
+        Str copy(source.c_str());
+        chars += copy.length();
+    }
+    benchmark_sink = chars;
+    return timer.Ms();
+}
+
+template <typename Str>
+double CopyBenchmark(const std::string& source, size_t repeats) {
+    Str original(source.c_str());
+    size_t chars = 0;
+    Timer<> timer;
+    for (size_t i = 0; i < repeats; ++i) {
+        Str copy = original;
+        chars += copy.length();
+    }
+    benchmark_sink = chars;
+    return timer.Ms();
+}
+
+template <typename Str>
+double PushBackBenchmark(size_t len, size_t repeats) {
+    size_t chars = 0;
+    Timer<> timer;
+    for (size_t i = 0; i < repeats; ++i) {
+        Str str;
+        for (size_t j = 0; j < len; ++j) {
+            str.push_back(static_cast<char>('a' + j % 26));
+        }
+        chars += str.length();
+    }
+    benchmark_sink = chars;
+    return timer.Ms();
+}
+
+template <typename Str>
+double AppendBenchmark(const std::string& source, size_t repeats) {
+    Str piece(source.c_str());
+    size_t chars = 0;
+    Timer<> timer;
+    for (size_t i = 0; i < repeats / 16 + 1; ++i) {
+        Str str;
+        for (size_t j = 0; j < 16; ++j) {
+            str += piece;
+        }
+        chars += str.length();
+    }
+    benchmark_sink = chars;
+    return timer.Ms();
+}
+
+// The needle sits at the far end for find and at the front for rfind, so both
+// scan the whole string.
+template <typename Str>
+double FindBenchmark(const std::string& source, size_t repeats, bool reverse) {
+    std::string text = source;
+    text.replace(reverse ? 0 : text.size() - 4, 4, "zq#!");
+    Str haystack(text.c_str());
+    Str needle("zq#!");
+    size_t found = 0;
+    Timer<> timer;
+    for (size_t i = 0; i < repeats; ++i) {
+        found += reverse ? haystack.rfind(needle) : haystack.find(needle);
+    }
+    benchmark_sink = found;
+    return timer.Ms();
+}
+
+template <typename Str>
+double SubstrBenchmark(const std::string& source, size_t repeats) {
+    Str str(source.c_str());
+    size_t chars = 0;
+    Timer<> timer;
+    for (size_t i = 0; i < repeats; ++i) {
+        chars += str.substr(i % 4, str.length() / 2).length();
+    }
+    benchmark_sink = chars;
+    return timer.Ms();
+}
+
+// Equal contents in separate buffers, so the comparison has to read them all
+template <typename Str>
+double CompareBenchmark(const std::string& source, size_t repeats) {
+    Str first(source.c_str());
+    Str second(source.c_str());
+    size_t equal = 0;
+    Timer<> timer;
+    for (size_t i = 0; i < repeats; ++i) {
+        equal += (first == second);
+        equal += (first < second);
+    }
+    benchmark_sink = equal;
+    return timer.Ms();
+}
+
+void BenchmarkCore() {
+    std::cerr << "Core operations:" << std::endl;
+
+    for (const SizeClass& size : kSizeClasses) {
+        std::string source(size.len, 'x');
+        for (size_t i = 0; i < source.size(); ++i) {
+            source[i] = static_cast<char>('a' + i * 7 % 26);
+        }
+        std::cerr << " " << size.name << " x " << size.repeats << std::endl;
+
+        ReportRow("construct", ConstructBenchmark<String>(source, size.repeats),
+                  ConstructBenchmark<std::string>(source, size.repeats));
+        ReportRow("copy", CopyBenchmark<String>(source, size.repeats),
+                  CopyBenchmark<std::string>(source, size.repeats));
+        ReportRow("push_back", PushBackBenchmark<String>(size.len, size.repeats),
+                  PushBackBenchmark<std::string>(size.len, size.repeats));
+        ReportRow("+= x16", AppendBenchmark<String>(source, size.repeats),
+                  AppendBenchmark<std::string>(source, size.repeats));
+        ReportRow("find", FindBenchmark<String>(source, size.repeats, false),
+                  FindBenchmark<std::string>(source, size.repeats, false));
+        ReportRow("rfind", FindBenchmark<String>(source, size.repeats, true),
+                  FindBenchmark<std::string>(source, size.repeats, true));
+        ReportRow("substr", SubstrBenchmark<String>(source, size.repeats),
+                  SubstrBenchmark<std::string>(source, size.repeats));
+        ReportRow("== and <", CompareBenchmark<String>(source, size.repeats),
+                  CompareBenchmark<std::string>(source, size.repeats));
+    }
+}
+
+void BenchmarkStreamInput() {
+    std::cerr << "Stream input:" << std::endl;
+
+    struct Shape {
+        const char* name;
+        size_t lines;
+        size_t words_per_line;
+        size_t word_len;
+    };
+    const Shape shapes[] = {
+        {"short words", 200'000, 10, 4},
+        {"long words", 20'000, 4, 400},
+        {"long lines", 200, 1, 100'000},
+    };
+
+    for (const Shape& shape : shapes) {
+        std::string input = MakeInput(shape.lines, shape.words_per_line, shape.word_len);
+        size_t mine_chars = 0;
+        size_t std_chars = 0;
+
+        std::cerr << " " << shape.name << " (" << input.size() / (1 << 20) << " MiB)" << std::endl;
+
+        double mine = ExtractWordsBenchmark<String>(input, mine_chars);
+        double baseline = ExtractWordsBenchmark<std::string>(input, std_chars);
+        assert(mine_chars == std_chars);
+        ReportRow("operator>>", mine, baseline);
+
+        mine = GetlineBenchmark<String>(input, mine_chars);
+        baseline = GetlineBenchmark<std::string>(input, std_chars);
+        assert(mine_chars == std_chars);
+        ReportRow("getline", mine, baseline);
+    }
+}
+
+// Builds one CSV-like row of 'fields' fields, 'field_len' chars each
+std::string MakeCsvRow(size_t fields, size_t field_len) {
+    std::string row;
+    for (size_t i = 0; i < fields; ++i) {
+        if (i != 0) {
+            row += ',';
+        }
+        row.append(field_len, static_cast<char>('a' + i % 26));
+    }
+    return row;
+}
+
+double GbPerSecond(size_t bytes, double ms) {
+    return bytes / ms / 1e6;
+}
+
+void BenchmarkSplit() {
+    std::cerr << "Split into fields:" << std::endl;
+
+    const size_t field_lens[] = {1, 8, 64};
+    const size_t total_bytes = 256 << 20;
+
+    for (size_t field_len : field_lens) {
+        String row(MakeCsvRow(4096 / (field_len + 1), field_len).c_str());
+        size_t repeats = total_bytes / row.length();
+        size_t expected_fields = 4096 / (field_len + 1) * repeats;
+
+        size_t fields = 0;
+        size_t chars = 0;
+        Timer<> timer;
+        for (size_t i = 0; i < repeats; ++i) {
+            StringView(row).split(',', [&](StringView field) {
+                ++fields;
+                chars += field.length();
+            });
+        }
+        double simd_ms = timer.Ms();
+        assert(fields == expected_fields);
+
+        // What callers did before: find(",") and substr for every field
+        size_t old_repeats = std::max<size_t>(repeats / 16, 1);
+        fields = 0;
+        timer = Timer<>();
+        for (size_t i = 0; i < old_repeats; ++i) {
+            String rest = row;
+            while (true) {
+                size_t pos = rest.find(",");
+                String field = rest.substr(0, pos);
+                chars += field.length();
+                ++fields;
+                if (pos == rest.length()) {
+                    break;
+                }
+                rest = rest.substr(pos + 1, rest.length());
+            }
+        }
+        double old_ms = timer.Ms();
+        assert(fields == expected_fields / repeats * old_repeats);
+
+        fields = 0;
+        timer = Timer<>();
+        for (size_t i = 0; i < repeats; ++i) {
+            std::string_view rest(row.data(), row.length());
+            while (true) {
+                size_t pos = rest.find(',');
+                chars += rest.substr(0, pos).size();
+                ++fields;
+                if (pos == std::string_view::npos) {
+                    break;
+                }
+                rest.remove_prefix(pos + 1);
+            }
+        }
+        double std_ms = timer.Ms();
+        assert(fields == expected_fields);
+
+        std::cerr << " " << field_len << "-char fields: StringView::split "
+                  << GbPerSecond(repeats * row.length(), simd_ms) << " GB/s, find+substr "
+                  << GbPerSecond(old_repeats * row.length(), old_ms) << " GB/s, std::string_view "
+                  << GbPerSecond(repeats * row.length(), std_ms) << " GB/s" << std::endl;
+        benchmark_sink = chars;
+    }
+}
+
+void BenchmarkUtf8() {
+    std::cerr << "UTF-8 validation:" << std::endl;
+
+    struct Text {
+        const char* name;
+        const char* sample;
+    };
+    const Text texts[] = {
+        {"ASCII", "plain ASCII text, the common case for most payloads. "},
+        {"mixed", "h\xC3\xA9llo w\xC3\xB6rld \xE2\x86\x92 \xE2\x9C\x93 \xF0\x9D\x84\x9E "},
+    };
+
+    for (const Text& text : texts) {
+        String payload;
+        while (payload.length() < (64 << 20)) {
+            payload += text.sample;
+        }
+
+        Timer<> timer;
+        bool valid = payload.is_valid_utf8();
+        double simd_ms = timer.Ms();
+        assert(valid);
+
+        timer = Timer<>();
+        valid = utf8::validate_scalar(reinterpret_cast<const unsigned char*>(payload.data()),
+                                      payload.length());
+        double scalar_ms = timer.Ms();
+        assert(valid);
+
+        timer = Timer<>();
+        benchmark_sink = payload.codepoint_count();
+        double count_ms = timer.Ms();
+
+        std::cerr << " " << text.name << ": is_valid_utf8 "
+                  << GbPerSecond(payload.length(), simd_ms) << " GB/s, scalar "
+                  << GbPerSecond(payload.length(), scalar_ms) << " GB/s, codepoint_count "
+                  << GbPerSecond(payload.length(), count_ms) << " GB/s" << std::endl;
+    }
+}
+
+void BenchmarkCaseFolding() {
+    std::cerr << "Header normalization:" << std::endl;
+
+    const char* headers[] = {"Content-Type", "Accept-Encoding", "X-Forwarded-For",
+                             "Strict-Transport-Security", "Access-Control-Allow-Credentials"};
+    const size_t repeats = 2'000'000;
+
+    size_t chars = 0;
+    Timer<> timer;
+    for (size_t i = 0; i < repeats; ++i) {
+        String header(headers[i % 5]);
+        header.to_lower();
+        chars += header[header.length() - 1];
+    }
+    double simd_ms = timer.Ms();
+
+    // What callers did before: tolower through operator[]
+    timer = Timer<>();
+    for (size_t i = 0; i < repeats; ++i) {
+        String header(headers[i % 5]);
+        for (size_t j = 0; j < header.length(); ++j) {
+            header[j] = static_cast<char>(std::tolower(static_cast<unsigned char>(header[j])));
+        }
+        chars += header[header.length() - 1];
+    }
+    double loop_ms = timer.Ms();
+    std::cerr << "  to_lower: " << simd_ms << " ms, tolower loop " << loop_ms << " ms (x"
+              << loop_ms / simd_ms << ")" << std::endl;
+
+    String haystack(MakeInput(1, 1, 1 << 20).c_str());
+    haystack += "NEEDLE";
+    timer = Timer<>();
+    for (size_t i = 0; i < 64; ++i) {
+        chars += haystack.find_ignore_case("needle");
+    }
+    std::cerr << "  find_ignore_case: " << GbPerSecond(64 * haystack.length(), timer.Ms())
+              << " GB/s" << std::endl;
+    benchmark_sink = chars;
+}
+
+void BenchmarkFindAll() {
+    std::cerr << "find_all over 512 MiB:" << std::endl;
+
+    String text;
+    text.reserve(512 << 20);
+    const char* sentence = "the quick brown fox jumps over the lazy dog; ";
+    while (text.length() < (512 << 20)) {
+        text += sentence;
+    }
+
+    string_parallel::ThreadPool single(0);
+    Timer<> timer;
+    std::vector<size_t> expected =
+        string_parallel::find_all(text.data(), text.length(), "lazy", 4, single);
+    double single_ms = timer.Ms();
+
+    timer = Timer<>();
+    std::vector<size_t> matches = text.find_all("lazy");
+    double parallel_ms = timer.Ms();
+    assert(matches == expected);
+
+    std::cerr << "  1 thread " << GbPerSecond(text.length(), single_ms) << " GB/s, "
+              << string_parallel::ThreadPool::shared().size() + 1 << " threads "
+              << GbPerSecond(text.length(), parallel_ms) << " GB/s, " << matches.size()
+              << " matches" << std::endl;
+}
+
+// Runs every suite, or only those named on the command line, e.g.
+// ./string_benchmark core split
+int main(int argc, char** argv) {
+    struct Suite {
+        const char* name;
+        void (*run)();
+    };
+    const Suite suites[] = {
+        {"core", BenchmarkCore},
+        {"stream", BenchmarkStreamInput},
+        {"split", BenchmarkSplit},
+        {"utf8", BenchmarkUtf8},
+        {"case", BenchmarkCaseFolding},
+        {"find_all", BenchmarkFindAll},
+    };
+
+    for (const Suite& suite : suites) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            selected |= std::string_view(argv[i]) == suite.name;
+        }
+        if (selected) {
+            suite.run();
+        }
+    }
+}
@@ -0,0 +1,796 @@
+#include "string.h"
+#include "../unordered_map/unordered_map.h"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Each search kernel against std::string on haystacks around the SSE2 and
+// AVX2 block widths and needles around the Horspool cutoff, over a two-letter
+// alphabet so that partial matches are everywhere
+void TestSearch() {
+    using Kernel = size_t (*)(const char*, size_t, const char*, size_t);
+    std::vector<std::pair<Kernel, Kernel>> kernels = {
+        {string_search::find, string_search::rfind},
+        {string_search::find_horspool, string_search::rfind_horspool},
+    };
+#ifdef STRING_SEARCH_X86
+    kernels.push_back({string_search::find_sse2, string_search::rfind_sse2});
+    if (string_search::has_avx2()) {
+        kernels.push_back({string_search::find_avx2, string_search::rfind_avx2});
+    }
+#endif
+    std::mt19937 rng(3);
+    const size_t needle_lengths[] = {1, 2, 3, 15, 16, 17, 31, 32, 33, 40};
+    for (size_t n = 0; n <= 96; ++n) {
+        for (size_t m : needle_lengths) {
+            for (int round = 0; round < 4; ++round) {
+                std::string hay(n, 'a');
+                std::string needle(m, 'a');
+                for (char& c : hay) c = "ab"[rng() % 8 == 0];
+                for (char& c : needle) c = "ab"[rng() % 8 == 0];
+                if (round % 2 == 1 && m <= n) {
+                    hay.replace(round == 1 ? n - m : rng() % (n - m + 1), m, needle);
+                }
+                size_t first = hay.find(needle);
+                size_t last = hay.rfind(needle);
+                if (first == std::string::npos) first = last = n;
+
+                for (auto [find, rfind] : kernels) {
+                    if (m > n) continue;
+                    assert(find(hay.data(), n, needle.data(), m) == first);
+                    assert(rfind(hay.data(), n, needle.data(), m) == last);
+                }
+                String string(StringView(hay.data(), n));
+                String pattern(StringView(needle.data(), m));
+                assert(string.find(pattern) == first);
+                assert(string.rfind(pattern) == last);
+            }
+        }
+    }
+    assert(String("abc").find(String()) == 3);
+}
+
+// Malformed sequences at every offset of fillers that cross the 32-byte AVX2
+// blocks, with the SIMD validator checked against the scalar one
+void TestUtf8() {
+    const std::string invalid[] = {
+        "\x80",                  // lone continuation byte
+        "\xC0\x80",              // overlong NUL
+        "\xC1\xBF",              // overlong two-byte
+        "\xE0\x80\x80",          // overlong three-byte
+        "\xF0\x80\x80\x80",      // overlong four-byte
+        "\xED\xA0\x80",          // UTF-16 surrogate
+        "\xF4\x90\x80\x80",      // above U+10FFFF
+        "\xF5\x80\x80\x80",      // invalid lead byte
+        "\xFF",
+        "\xE2\x28\xA1",          // bad continuation
+        "\xE2\x82",              // truncated
+        "\xC3\xA9\xA9",          // extra continuation
+    };
+    const std::string valid[] = {"a", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80",
+                                 "\xF4\x8F\xBF\xBF", "\xED\x9F\xBF"};
+    for (const std::string& unit : valid) {
+        for (size_t repeat = 1; repeat <= 40; ++repeat) {
+            std::string text;
+            for (size_t i = 0; i < repeat; ++i) text += unit;
+            String string(StringView(text.data(), text.size()));
+            assert(string.is_valid_utf8());
+            assert(string.codepoint_count() == repeat);
+            size_t decoded = 0;
+            for (char32_t cp : string.codepoints()) {
+                assert(cp != utf8::CodepointIterator::kReplacement);
+                ++decoded;
+            }
+            assert(decoded == repeat);
+        }
+    }
+    for (const std::string& bad : invalid) {
+        for (size_t filler = 0; filler <= 70; ++filler) {
+            std::string text(filler, 'x');
+            text.insert(filler / 2, bad);
+            const auto* bytes = reinterpret_cast<const unsigned char*>(text.data());
+            assert(!utf8::validate_scalar(bytes, text.size()));
+            assert(!utf8::validate(text.data(), text.size()));
+            text.insert(0, "\xE2\x82\xAC");
+            assert(!utf8::validate(text.data(), text.size()));
+        }
+    }
+    // A truncated sequence at the very end of a block-sized input
+    std::string tail(63, 'x');
+    tail += '\xE2';
+    assert(!utf8::validate(tail.data(), tail.size()));
+}
+
+// Appending a string's own chars, also when its buffer is shared or has to
+// move to grow
+void TestAppendAliasing() {
+    String big(100, 'x');
+    big.share();
+    const String& const_big = big;
+    big.append(const_big.data(), 50);
+    assert(big == String(150, 'x'));
+
+    String shared(40, 'a');
+    shared += String(40, 'b');
+    shared.share();
+    String copy = shared;
+    shared.append(static_cast<const String&>(shared).data() + 40, 40);
+    assert(shared.length() == 120);
+    assert(StringView(shared).substr(80, 40) == StringView(String(40, 'b')));
+    assert(copy.length() == 80);
+
+    String small("abc");
+    small.append(small.data(), 3);
+    small.append(static_cast<const String&>(small).data(), 6);
+    assert(small == "abcabcabcabc");
+}
+
+// Copies of a shared string reference one buffer until one of them is
+// written to; writers detach and never change what the others see
+void TestCopyOnWrite() {
+    String original(64, 'c');
+    original.share();
+    String copy = original;
+    String assigned;
+    assigned = copy;
+    assert(original.use_count() == 3);
+    assert(static_cast<const String&>(copy).data() == static_cast<const String&>(original).data());
+
+    copy[0] = 'X';
+    assert(copy.use_count() == 1 && original.use_count() == 2);
+    assert(original == String(64, 'c') && assigned == original);
+    assert(copy[0] == 'X');
+
+    assigned.push_back('p');
+    assert(original.use_count() == 1);
+    assert(original.length() == 64 && assigned.length() == 65);
+
+    // Appending a shared string to itself, and to a string it shares with
+    original.share();
+    String twin = original;
+    original += original;
+    assert(original == String(128, 'c') && twin == String(64, 'c'));
+    twin += static_cast<const String&>(twin);
+    assert(twin == String(128, 'c'));
+
+    // A char& taken after detaching stays private to its string
+    String base(50, 'z');
+    base.share();
+    String other = base;
+    char& first = base[0];
+    String later = base;
+    first = 'Q';
+    assert(later[0] == 'z' && other[0] == 'z' && base[0] == 'Q');
+
+    // Copies made and dropped concurrently from one shared buffer
+    String source(1000, 's');
+    source.share();
+    auto churn = [&source] {
+        for (int i = 0; i < 10000; ++i) {
+            String local = source;
+            assert(local.length() == 1000);
+            if (i % 100 == 0) local.push_back('!');
+        }
+    };
+    std::thread worker(churn);
+    churn();
+    worker.join();
+    assert(source.use_count() == 1);
+}
+
+// Numbers short enough for the inline buffer stay inline, long fixed-point
+// floats still come out whole
+void TestAppendNumber() {
+    String number;
+    size_t inline_capacity = number.capacity();
+    number.append_number(-12345);
+    assert(number == "-12345");
+    assert(number.capacity() == inline_capacity);
+
+    String big;
+    big.append_number(1e300, std::chars_format::fixed);
+    assert(big.length() == 301);
+    assert(big[0] == '1' && big[300] == '0');
+}
+
+void TestReserveShared() {
+    String text(100, 'r');
+    text.share();
+    String copy = text;
+    text.reserve(1000);
+    assert(text.capacity() >= 1000);
+    assert(text.use_count() == 1 && copy.use_count() == 1);
+    assert(text == copy);
+
+    text.share();
+    String second = text;
+    text.reserve(10);
+    assert(text.use_count() == 1);
+    assert(text == second);
+}
+
+// Patterns over all 256 byte values, where no byte is left for the class of
+// bytes that occur in no pattern
+void TestPatternSetAllBytes() {
+    std::vector<String> patterns;
+    for (int c = 1; c < 256; ++c) {
+        patterns.push_back(String(static_cast<char>(c)));
+    }
+    patterns.push_back(String(2, '\0'));
+    PatternSet set(patterns);
+
+    std::vector<PatternSet::Match> matches = set.find_all(String(2, '\0'));
+    assert(matches.size() == 1);
+    assert(matches[0].pattern == 255 && matches[0].pos == 0);
+
+    String every;
+    for (int c = 255; c >= 0; --c) {
+        every.push_back(static_cast<char>(c));
+    }
+    matches = set.find_all(every);
+    assert(matches.size() == 255);
+    for (size_t i = 0; i < matches.size(); ++i) {
+        assert(matches[i].pos == i);
+        assert(matches[i].pattern == 254 - i);
+    }
+}
+
+// push_back appends in place only where no copy or iterator can see it, and
+// const members leave a rope shared between threads untouched
+void TestRope() {
+    RopeString rope;
+    std::string expected;
+    RopeString snapshot;
+    for (int i = 0; i < 3000; ++i) {
+        char c = static_cast<char>('a' + i % 26);
+        if (i == 700) {
+            snapshot = rope;
+        }
+        rope.push_back(c);
+        expected += c;
+    }
+    assert(rope.length() == expected.size());
+    assert(snapshot.length() == 700);
+    assert(snapshot.str() == String(StringView(expected.data(), 700)));
+
+    auto it = rope.begin();
+    rope.push_back('!');
+    for (size_t i = 0; i < expected.size(); ++i, ++it) {
+        assert(*it == expected[i]);
+    }
+    assert(rope[expected.size()] == '!');
+    expected += '!';
+
+    RopeString joined = rope + RopeString("tail") + rope;
+    std::string joined_expected = expected + "tail" + expected;
+    const RopeString& shared = joined;
+    size_t tail = joined_expected.find("!tail");
+    size_t last_xyz = joined_expected.rfind("xyz");
+    auto search = [&shared, tail, last_xyz] {
+        for (int i = 0; i < 20; ++i) {
+            assert(shared.find(StringView("!tail")) == tail);
+            assert(shared.rfind(StringView("xyz")) == last_xyz);
+        }
+    };
+    std::thread other(search);
+    search();
+    other.join();
+    assert(StringView(joined) == StringView(joined_expected.data(), joined_expected.size()));
+}
+
+// Leaf-by-leaf search against std::string, with needles shorter than a leaf
+// and needles spanning several leaves, so that matches cross one boundary or
+// many
+void TestRopeSearch() {
+    std::mt19937 rng(8);
+    for (int round = 0; round < 20; ++round) {
+        // Pieces of 257 to 511 chars are never merged into one leaf
+        RopeString rope;
+        std::string expected;
+        while (expected.size() < 5000) {
+            std::string piece(257 + rng() % 255, 'a');
+            for (char& c : piece) c = "ab"[rng() % 16 == 0];
+            rope += RopeString(StringView(piece.data(), piece.size()));
+            expected += piece;
+        }
+        size_t leaves = 0;
+        rope.for_each_chunk([&leaves](StringView) { ++leaves; });
+        assert(leaves >= 10);
+
+        for (size_t m : {1, 2, 3, 5, 17, 33, 300, 700, 1200}) {
+            for (int kind = 0; kind < 3; ++kind) {
+                std::string needle(m, 'a');
+                if (kind == 0) {
+                    for (char& c : needle) c = "ab"[rng() % 16 == 0];
+                } else {
+                    needle = expected.substr(rng() % (expected.size() - m + 1), m);
+                }
+                size_t first = expected.find(needle);
+                size_t last = expected.rfind(needle);
+                if (first == std::string::npos) first = last = expected.size();
+                StringView view(needle.data(), needle.size());
+                assert(rope.find(view) == first);
+                assert(rope.rfind(view) == last);
+            }
+        }
+    }
+    RopeString two = RopeString(String(300, 'x')) + RopeString(String(300, 'y'));
+    assert(two.find(StringView("xy")) == 299 && two.rfind(StringView("xy")) == 299);
+    assert(two.find(StringView("")) == 600 && two.find(StringView("z")) == 600);
+    assert(RopeString().find(StringView("a")) == 0);
+}
+
+// Short strings live in the object: empty, single chars and up to 15 chars
+// keep the inline capacity through copies, shrinking and clearing
+void TestSmallStrings() {
+    String empty;
+    const size_t inline_capacity = empty.capacity();
+    assert(inline_capacity == 15);
+    String one('x');
+    String fifteen("abcdefghijklmno");
+    String copy = fifteen;
+    assert(one.capacity() == inline_capacity && fifteen.capacity() == inline_capacity);
+    assert(copy == fifteen && copy.data() != fifteen.data());
+
+    String grown = fifteen;
+    grown.push_back('p');
+    assert(grown.capacity() > inline_capacity && grown == "abcdefghijklmnop");
+    grown.pop_back();
+    grown.shrink_to_fit();
+    assert(grown.capacity() == inline_capacity && grown == fifteen);
+    assert(grown.data()[grown.length()] == '\0');
+
+    String long_string(100, 'l');
+    long_string = one;
+    assert(long_string == "x");
+    String swapped = std::move(fifteen);
+    assert(swapped == "abcdefghijklmno");
+}
+
+// Moves hand the heap buffer over, rvalue chains of + grow one buffer, and
+// copy assignment reuses a buffer that is already big enough
+void TestMoveAndConcatenation() {
+    String heap(40, 'h');
+    const char* buffer = static_cast<const String&>(heap).data();
+    String moved = std::move(heap);
+    assert(static_cast<const String&>(moved).data() == buffer && moved == String(40, 'h'));
+    String assigned;
+    assigned = std::move(moved);
+    assert(static_cast<const String&>(assigned).data() == buffer);
+
+    String a("first ");
+    String b("second ");
+    String c("third ");
+    String d("fourth");
+    String sentence = a + b + c + d;
+    assert(sentence == "first second third fourth");
+
+    String base;
+    base.reserve(64);
+    base += "x";
+    const char* reserved = static_cast<const String&>(base).data();
+    String chained = std::move(base) + b + c + d;
+    assert(static_cast<const String&>(chained).data() == reserved);
+    assert(chained == "xsecond third fourth");
+
+    String target(60, 't');
+    const char* target_buffer = static_cast<const String&>(target).data();
+    String source(50, 'u');
+    target = source;
+    assert(static_cast<const String&>(target).data() == target_buffer && target == source);
+}
+
+// Views point into the string they were taken from and never allocate
+void TestStringView() {
+    String line("  key = value\t");
+    StringView view = line;
+    assert(view.data() == static_cast<const String&>(line).data() && view.length() == line.length());
+    StringView trimmed = view.trim();
+    assert(trimmed == StringView("key = value"));
+    assert(trimmed.data() == view.data() + 2);
+    assert(trimmed.starts_with(StringView("key")) && trimmed.ends_with(StringView("value")));
+    assert(trimmed.find(StringView("=")) == 4 && trimmed.find('z') == trimmed.length());
+    assert(trimmed.substr(6, 100) == StringView("value"));
+    assert(line.view(2, 3) == StringView("key"));
+
+    StringView rest = trimmed;
+    rest.remove_prefix(6);
+    rest.remove_suffix(2);
+    assert(rest == StringView("val"));
+    assert(String(rest) == "val");
+
+    std::ostringstream out;
+    out << trimmed;
+    assert(out.str() == "key = value");
+}
+
+// Comparisons use the stored length: embedded NULs count, and bytes compare
+// as unsigned
+void TestComparisons() {
+    String with_nul(StringView("ab\0c", 4));
+    String prefix("ab");
+    assert(with_nul != prefix && with_nul.length() == 4);
+    assert(prefix < with_nul);
+    assert(with_nul < String(StringView("ab\0d", 4)));
+    assert(String("\xFF") > String("a"));
+    assert((String("abc") <=> String("abd")) == std::strong_ordering::less);
+    assert((String("abc") <=> String("abc")) == std::strong_ordering::equal);
+    assert(String("abc") == "abc" && "abd" > String("abc"));
+    assert((StringView("b") <=> StringView("ab")) == std::strong_ordering::greater);
+
+    std::vector<String> words = {"pear", "apple", "fig", "apple pie", "Apple"};
+    std::sort(words.begin(), words.end());
+    assert(words[0] == "Apple" && words[1] == "apple" && words[2] == "apple pie");
+    assert(words[3] == "fig" && words[4] == "pear");
+}
+
+// Word and line extraction over input longer than the stream buffer, so
+// words and lines straddle chunk boundaries
+void TestStreamInput() {
+    std::string input;
+    for (int i = 0; i < 5000; ++i) {
+        input += "word" + std::to_string(i) + (i % 10 == 9 ? "\n" : "  ");
+    }
+    std::istringstream words(input);
+    String word;
+    int count = 0;
+    while (words >> word) {
+        if (word.empty()) continue;
+        assert(word == String(("word" + std::to_string(count)).c_str()));
+        ++count;
+    }
+    assert(count == 5000);
+
+    std::istringstream lines("first line\n\nthird;last");
+    String line;
+    assert(getline(lines, line) && line == "first line");
+    assert(getline(lines, line) && line.empty());
+    assert(getline(lines, line, ';') && line == "third");
+    assert(getline(lines, line) && line == "last" && lines.eof());
+    assert(!getline(lines, line));
+}
+
+// Equal contents intern to one entry, so handles compare by pointer and
+// carry the hash computed at interning time
+void TestInterning() {
+    StringPool pool;
+    std::vector<InternedString> handles;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 1000; ++i) {
+            String key("key");
+            key.append_number(i);
+            InternedString handle = pool.intern(key);
+            if (round == 0) {
+                handles.push_back(handle);
+            } else {
+                assert(handle == handles[i]);
+                assert(handle.data() == handles[i].data());
+            }
+        }
+    }
+    assert(pool.size() == 1000);
+    assert(handles[7] != handles[8]);
+    assert(StringView(handles[42]) == StringView("key42"));
+    assert(handles[42].hash() == std::hash<StringView>()(StringView("key42")));
+    assert(pool.find(StringView("key999")) == handles[999]);
+    assert(pool.find(StringView("missing")).empty() && pool.size() == 1000);
+    assert(pool.intern(StringView("")) == InternedString());
+
+    // Handles as keys of the repo's own map, looked up by handles interned again
+    UnorderedMap<InternedString, int> counts;
+    for (int i = 0; i < 3000; ++i) {
+        String key("key");
+        key.append_number(i % 1000);
+        ++counts[pool.intern(key)];
+    }
+    assert(counts.size() == 1000 && counts[handles[5]] == 3);
+    assert(counts.find(pool.intern(StringView("key999"))) != counts.end());
+    assert(counts.find(pool.intern(StringView("fresh"))) == counts.end());
+}
+
+// Stateful allocator that counts what passes through one arena
+struct Arena {
+    size_t allocated = 0;
+    size_t live = 0;
+};
+
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+    Arena* arena;
+
+    explicit ArenaAllocator(Arena* arena) : arena(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        arena->allocated += n * sizeof(T);
+        ++arena->live;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        --arena->live;
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+};
+
+// Every heap buffer, shared ones included, comes from the string's allocator
+void TestAllocator() {
+    using ArenaString = BasicString<char, ArenaAllocator<char>>;
+    Arena arena;
+    Arena other_arena;
+    {
+        ArenaAllocator<char> alloc(&arena);
+        ArenaString text(100, 'a', alloc);
+        text.append("bcd");
+        ArenaString copy = text;
+        assert(copy.get_allocator() == alloc && copy == text);
+        text.share();
+        ArenaString shared = text;
+        assert(shared.use_count() == 2);
+        ArenaString short_text("short", alloc);
+        assert(arena.live == 2);
+
+        ArenaString elsewhere{ArenaAllocator<char>(&other_arena)};
+        elsewhere = text;
+        assert(elsewhere == text && elsewhere.get_allocator() == ArenaAllocator<char>(&other_arena));
+        assert(other_arena.live == 1 && text.use_count() == 2);
+        ArenaString moved = std::move(copy);
+        assert(moved.get_allocator() == alloc);
+    }
+    assert(arena.allocated > 0 && arena.live == 0 && other_arena.live == 0);
+}
+
+// Fields between delimiters, empty ones included, at every density and at
+// lengths around the vector block widths, as views into the line
+void TestSplit() {
+    std::mt19937 rng(13);
+    for (size_t n = 0; n <= 100; ++n) {
+        for (int density : {2, 5, 40}) {
+            std::string line(n, 'f');
+            for (char& c : line) {
+                if (rng() % density == 0) c = ',';
+            }
+            std::vector<std::string> expected(1);
+            for (char c : line) {
+                if (c == ',') {
+                    expected.emplace_back();
+                } else {
+                    expected.back() += c;
+                }
+            }
+            String string(StringView(line.data(), line.size()));
+            StringView view = string;
+            std::vector<StringView> fields = view.split(',');
+            assert(fields.size() == expected.size());
+            for (size_t i = 0; i < fields.size(); ++i) {
+                assert(fields[i] == StringView(expected[i].data(), expected[i].size()));
+                assert(fields[i].data() >= view.data() && fields[i].data() <= view.data() + n);
+            }
+        }
+    }
+}
+
+// String, StringView and HashedString hash the same bytes alike, every input
+// length through the wyhash tail cases gives distinct hashes
+void TestHashing() {
+    std::string bytes;
+    std::vector<size_t> hashes;
+    for (size_t n = 0; n <= 80; ++n) {
+        String string(StringView(bytes.data(), bytes.size()));
+        size_t hash = std::hash<String>()(string);
+        assert(hash == std::hash<StringView>()(StringView(string)));
+        assert(hash == HashedString(string).hash());
+        assert(hash == std::hash<HashedString>()(HashedString(string)));
+        hashes.push_back(hash);
+        bytes += static_cast<char>('a' + n % 7);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    assert(std::adjacent_find(hashes.begin(), hashes.end()) == hashes.end());
+    assert(string_hash::hash_bytes("abc", 3, 1) != string_hash::hash_bytes("abc", 3, 2));
+
+    assert(HashedString("key") == HashedString(String("key")));
+    assert(!(HashedString("key") == HashedString("kez")));
+
+    std::unordered_map<String, int> counts;
+    for (int i = 0; i < 100; ++i) {
+        String key("k");
+        key.append_number(i % 10);
+        ++counts[key];
+    }
+    assert(counts.size() == 10 && counts[String("k3")] == 10);
+}
+
+// Mapped files read like a String without being copied; a missing file
+// throws and an empty one maps to an empty string
+void TestMappedString() {
+#ifdef STRING_HAS_MMAP
+    std::string path = (std::filesystem::temp_directory_path() / "string_test_mapped.txt").string();
+    std::string contents;
+    for (int i = 0; i < 20000; ++i) {
+        contents += "line " + std::to_string(i) + "\n";
+    }
+    std::ofstream(path, std::ios::binary) << contents;
+
+    MappedString mapped(path.c_str());
+    assert(mapped.length() == contents.size());
+    assert(mapped[5] == contents[5] && mapped.back() == '\n');
+    assert(mapped.find(StringView("line 19999")) == contents.find("line 19999"));
+    assert(mapped.rfind(StringView("line 1\n")) == contents.rfind("line 1\n"));
+    assert(mapped.substr(0, 7) == StringView("line 0\n"));
+
+    MappedString moved = std::move(mapped);
+    assert(moved.length() == contents.size() && mapped.empty());
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc).flush();
+    assert(MappedString(path.c_str()).empty());
+    std::filesystem::remove(path);
+
+    bool threw = false;
+    try {
+        MappedString missing(path.c_str());
+    } catch (const std::system_error& error) {
+        threw = error.code() == std::errc::no_such_file_or_directory;
+    }
+    assert(threw);
+#endif
+}
+
+// Only A-Z and a-z fold, for every byte value and at lengths around the
+// 16-byte blocks of the vector kernels
+void TestCaseFolding() {
+    for (size_t n = 0; n <= 300; n += (n < 40 ? 1 : 37)) {
+        std::string bytes(n, '\0');
+        for (size_t i = 0; i < n; ++i) bytes[i] = static_cast<char>((i * 37 + n) % 256);
+        std::string lower = bytes;
+        std::string upper = bytes;
+        for (char& c : lower) c = ascii::lower(c);
+        for (char& c : upper) c = ascii::upper(c);
+
+        String string(StringView(bytes.data(), n));
+        String copy = string;
+        assert(StringView(string.to_lower()) == StringView(lower.data(), n));
+        assert(StringView(copy.to_upper()) == StringView(upper.data(), n));
+        assert(string.equals_ignore_case(StringView(upper.data(), n)));
+        assert(CaseInsensitiveHash()(StringView(lower.data(), n)) ==
+               CaseInsensitiveHash()(StringView(upper.data(), n)));
+    }
+
+    String header("Content-Type: Text/HTML; charset=UTF-8");
+    assert(header.find_ignore_case(StringView("text/html")) == 14);
+    assert(header.find_ignore_case(StringView("CHARSET=utf-8")) == 25);
+    assert(header.find_ignore_case(StringView("xml")) == header.length());
+    StringView view = header;
+    assert(view.compare_ignore_case(StringView("CONTENT-TYPE: TEXT/HTML; CHARSET=UTF-8")) ==
+           std::weak_ordering::equivalent);
+    assert(StringView("apple").compare_ignore_case(StringView("BANANA")) == std::weak_ordering::less);
+    assert(!StringView("a@").equals_ignore_case(StringView("A`")));
+}
+
+// Parallel find_all on inputs large enough to be cut into chunks, with
+// overlapping matches straddling the cuts, against a sequential scan
+void TestFindAll() {
+    std::mt19937 rng(18);
+    std::string text(3 << 20, 'a');
+    for (char& c : text) {
+        if (rng() % 3 == 0) c = 'b';
+    }
+    string_parallel::ThreadPool pool(4);
+    for (const std::string& needle : std::vector<std::string>{"a", "aba", "abab", std::string(40, 'a')}) {
+        std::vector<size_t> expected;
+        for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+            expected.push_back(pos);
+        }
+        assert(string_parallel::find_all(text.data(), text.size(), needle.data(), needle.size(), pool) ==
+               expected);
+        if (needle.size() == 3) {
+            String string(StringView(text.data(), text.size()));
+            assert(string.find_all(StringView(needle.data(), needle.size())) == expected);
+        }
+    }
+
+    // A long needle matching at almost every offset, on both sides of chunk
+    // cuts, where each match resumes the shift-table scan one byte later
+    std::string dense(1 << 20, 'a');
+    dense[12345] = 'b';
+    std::string long_needle(33, 'a');
+    std::vector<size_t> found =
+        string_parallel::find_all(dense.data(), dense.size(), long_needle.data(), long_needle.size(), pool);
+    assert(found.size() == dense.size() - 2 * long_needle.size() + 1);
+    for (size_t i = 0; i < found.size(); ++i) {
+        assert(found[i] == (i < 12345 - 32 ? i : i + 33));
+    }
+    assert(StringView("aaaa").find_all(StringView("aa")) == std::vector<size_t>({0, 1, 2}));
+    assert(StringView("abc").find_all(StringView("")).empty());
+}
+
+// Counters follow allocations, reallocations and shrinks when the file is
+// built with -DSTRING_INSTRUMENTATION, and stay at zero otherwise
+void TestAllocationStats() {
+    StringStats before = string_stats::snapshot();
+    {
+        String text(100, 'a');
+        text.push_back('b');
+        text.resize(40);
+        text.shrink_to_fit();
+        String inline_text("short");
+        inline_text.append_number(12);
+    }
+    StringStats delta = string_stats::snapshot() - before;
+    if constexpr (string_stats::kEnabled) {
+        assert(delta.allocations == 3 && delta.deallocations == 3);
+        assert(delta.reallocations == 1 && delta.shrinks == 1);
+        assert(delta.bytes_copied == 101 + 41);
+    } else {
+        assert(delta.allocations == 0 && delta.reallocations == 0 && delta.bytes_copied == 0);
+    }
+
+    std::thread other([] {
+        String local(200, 'x');
+        local += local;
+    });
+    other.join();
+    assert((string_stats::snapshot() - before).allocations == delta.allocations);
+}
+
+int main() {
+    TestSearch();
+    std::cerr << "TestSearch passed" << std::endl;
+    TestUtf8();
+    std::cerr << "TestUtf8 passed" << std::endl;
+    TestAppendAliasing();
+    std::cerr << "TestAppendAliasing passed" << std::endl;
+    TestCopyOnWrite();
+    std::cerr << "TestCopyOnWrite passed" << std::endl;
+    TestAppendNumber();
+    std::cerr << "TestAppendNumber passed" << std::endl;
+    TestReserveShared();
+    std::cerr << "TestReserveShared passed" << std::endl;
+    TestPatternSetAllBytes();
+    std::cerr << "TestPatternSetAllBytes passed" << std::endl;
+    TestRope();
+    std::cerr << "TestRope passed" << std::endl;
+    TestRopeSearch();
+    std::cerr << "TestRopeSearch passed" << std::endl;
+    TestSmallStrings();
+    std::cerr << "TestSmallStrings passed" << std::endl;
+    TestMoveAndConcatenation();
+    std::cerr << "TestMoveAndConcatenation passed" << std::endl;
+    TestStringView();
+    std::cerr << "TestStringView passed" << std::endl;
+    TestComparisons();
+    std::cerr << "TestComparisons passed" << std::endl;
+    TestStreamInput();
+    std::cerr << "TestStreamInput passed" << std::endl;
+    TestInterning();
+    std::cerr << "TestInterning passed" << std::endl;
+    TestAllocator();
+    std::cerr << "TestAllocator passed" << std::endl;
+    TestSplit();
+    std::cerr << "TestSplit passed" << std::endl;
+    TestHashing();
+    std::cerr << "TestHashing passed" << std::endl;
+    TestMappedString();
+    std::cerr << "TestMappedString passed" << std::endl;
+    TestCaseFolding();
+    std::cerr << "TestCaseFolding passed" << std::endl;
+    TestFindAll();
+    std::cerr << "TestFindAll passed" << std::endl;
+    TestAllocationStats();
+    std::cerr << "TestAllocationStats passed" << std::endl;
+}
@@ -335,6 +335,20 @@ public:
     return new_node;
   }
 
+  // Relinks the node at iter in front of pos, without copying or moving its value.
+  iterator splice(const_iterator pos, const_iterator iter) {
+    BaseNode* node = iter.get_ptr();
+    BaseNode* next_node = pos.get_ptr();
+    if (node == next_node) return node;
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = next_node->prev;
+    node->next = next_node;
+    next_node->prev->next = node;
+    next_node->prev = node;
+    return node;
+  }
+
   iterator erase(const_iterator iter) {
     BaseNode* current_node = iter.get_ptr();
     if (current_node == &endNode) {
@@ -355,6 +369,7 @@ public:
     }
     endNode.prev = &endNode;
     endNode.next = &endNode;
+    size_ = 0;
   }
 
   template<typename... Args>
@@ -502,9 +517,13 @@ private:
     size_t old_bucket_count = bucket_count_;
     allocate_buckets(new_bucket_count);
 
-    for (auto node = nodes_.begin(); node != nodes_.end(); ++node) {
-      size_t ind = hash(node->data_.first) % bucket_count_;
-      if (buckets_[ind].size_++ == 0) buckets_[ind].it_ = node;
+    // Buckets are contiguous runs of nodes_, so every node is relinked in
+    // front of its new bucket's run, or at the end when the bucket is new.
+    for (size_t count = nodes_.size(); count > 0; --count) {
+      ListIterator node = nodes_.begin();
+      auto& bucket = buckets_[hash(node->data_.first) % bucket_count_];
+      bucket.it_ = nodes_.splice(bucket.size_ == 0 ? nodes_.end() : bucket.it_, node);
+      ++bucket.size_;
     }
 
     for (size_t i = 0; i < old_bucket_count; ++i) {
@@ -715,8 +734,9 @@ public:
 
   iterator find(const Key& key) {
     size_t ind = hash(key) % bucket_count_;
-    for (size_t i = 0; i < buckets_[ind].size_; ++i) {
-      if (equal(buckets_[ind].it_->data_.first, key)) return iterator(buckets_[ind].it_);
+    auto it_list = buckets_[ind].it_;
+    for (size_t i = 0; i < buckets_[ind].size_; ++i, ++it_list) {
+      if (equal(it_list->data_.first, key)) return iterator(it_list);
     }
     return end();
 }
@@ -780,17 +800,19 @@ public:
     Node new_node(std::move(*new_val));
     AllocNodeTraitsType::destroy(alloc, new_val);
     AllocNodeTraitsType::deallocate(alloc, new_val, 1);
+    // The new node opens its bucket's run, so the run stays contiguous
     if (bucket.size_ == 0) {
       nodes_.push_back(std::move(new_node));
       bucket.it_ = --nodes_.end();
     } else {
-      nodes_.insert(bucket.it_, std::move(new_node));
+      bucket.it_ = nodes_.insert(bucket.it_, std::move(new_node));
     }
     ++bucket.size_;
+    ListIterator inserted = bucket.it_;
     if (load_factor() > max_load_factor_) {
       rehash(bucket_count_ * 2);
     }
-    return { --nodes_.end(), true };
+    return { inserted, true };
   }
   
   iterator erase(const_iterator pos) {